@@ -27,12 +27,10 @@
 
 #pragma once
 
-//enable simd functions
-//set GL2D_SIMD to 0 if it doesn't work on your platform
-#ifdef _WIN32
+//enable simd functions, the instruction set is picked at runtime
+//set GL2D_SIMD to 0 to only use the scalar loops
+#ifndef GL2D_SIMD
 #define GL2D_SIMD 1
-#else
-#define GL2D_SIMD 0
 #endif
 
 //if you are not using visual studio make shure you link to "Opengl32.lib"
@@ -52,11 +50,50 @@
 //this is the default capacity of the renderer
 #define GL2D_DefaultTextureCoords (glm::vec4{ 0, 1, 1, 0 })
 
+//clip rect (in screen coords) that doesn't clip anything
+#define GL2D_NoClipRect (glm::vec4{ -2, -2, 2, 2 })
+
+//max number of views for Renderer2D::flushMultiView
+#define GL2D_MAX_VIEWS 8
+//uniform buffer binding point used by flushMultiView
+#define GL2D_VIEWS_UNIFORM_BINDING 0
+
+#define GL2D_STRINGIFY_(x) #x
+#define GL2D_STRINGIFY(x) GL2D_STRINGIFY_(x)
+
+//number of gpu timer queries in flight used by DynamicResolution
+#define GL2D_DYNAMIC_RESOLUTION_QUERIES 4
+
+//max number of points for renderConvexPolygon
+#define GL2D_MAX_POLYGON_POINTS 64
+
+//max number of glyphs kept by the renderText layout cache
+#define GL2D_TEXT_LAYOUT_CACHE_GLYPHS 16384
+
+//default gpu memory used by the atlas pages of a GlyphCache
+#define GL2D_GLYPH_CACHE_BUDGET (4 * 1024 * 1024)
+
+//bytes copied into the upload buffer at a time by AsyncTextureLoader::update, the time budget is checked between them
+#define GL2D_ASYNC_TEXTURE_UPLOAD_CHUNK (256 * 1024)
+
+//textures drawn in the last this many frames are never evicted by the texture memory budget
+//(a frame is a Renderer2D::updateWindowMetrics call)
+#define GL2D_TEXTURE_EVICTION_MIN_AGE 120
+
 #include <glad/glad.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <glm/glm.hpp>
+#include <list>
+#include <mutex>
 #include <random>
 #include <stb_image/stb_image.h>
 #include <stb_truetype/stb_truetype.h>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
 namespace gl2d
@@ -84,10 +121,15 @@ namespace gl2d
 	//returns false on fail
 	bool setVsync(bool b);
 
+	//Baked fonts are saved here and loaded (memory mapped) the next time the same font is created.
+	//The directory has to exist, nullptr or "" disables the cache.
+	void setFontCacheDirectory(const char *directory);
+
 	struct ShaderProgram
 	{
 		GLuint id;
 		int u_sampler;
+		int u_depthStep = -1; //only the default vertex shader has it, needed for the early z pass
 	};
 
 	ShaderProgram createShaderProgram(const char *vertex, const char *fragment);
@@ -102,7 +144,96 @@ namespace gl2d
 		stbtt_aligned_quad fontGetGlyphQuad(const Font font, const char c);
 		glm::vec4 fontGetGlyphTextureCoords(const Font font, const char c);
 
+		//a glyph of the font atlas or of the glyph cache
+		struct FontGlyph
+		{
+			glm::vec4 quad = {}; //x0 y0 x1 y1 relative to the pen, in font pixels
+			glm::vec4 uv = {};
+			glm::vec2 uvPadding = {}; //sdf padding in uv
+			GLuint texture = 0;
+			int page = -1; //glyph cache page, -1 for the font atlas
+		};
+
+		//returns false if the font doesn't have the glyph
+		bool fontGetGlyph(const Font &font, const uint32_t codepoint, FontGlyph &out);
+
+		//Decodes one codepoint and advances text. Invalid sequences return U+FFFD.
+		uint32_t decodeUTF8(const char *&text, const char *end);
+
+		uint64_t hashFNV1a(const void *data, const size_t size, uint64_t hash = 14695981039346656037ull);
+
+		//read only memory mapped file
+		struct MappedFile
+		{
+			const unsigned char *data = nullptr;
+			size_t size = 0;
+
+			MappedFile() {};
+			MappedFile(const MappedFile &) = delete;
+			MappedFile &operator=(const MappedFile &) = delete;
+			~MappedFile() { close(); }
+
+			bool open(const char *path);
+			void close();
+
+		private:
+		#ifdef _WIN32
+			void *file = (void *)(intptr_t)-1;
+			void *mapping = nullptr;
+		#else
+			int fd = -1;
+		#endif
+		};
+
 		glm::vec2 convertPoint(const Camera &c, const glm::vec2 &p, float windowW, float windowH);
+
+		//calls the error callback, used by the other gl2d modules
+		void reportError(const char *msg);
+
+		//Records (or updates after a resize) the texture in the registry. New textures start with one reference.
+		void registerTexture(GLuint id, glm::ivec2 size, GLenum internalFormat, bool mipMaps);
+
+		//Drops a reference, returns true when the gl texture has to be deleted (also for unregistered textures).
+		bool releaseTexture(GLuint id);
+
+		//Changes every time the id is registered again, so work queued for a deleted texture
+		//can tell that the driver gave its id to another one. 0 if the texture isn't registered.
+		unsigned int getTextureGeneration(GLuint id);
+
+		//returns the texture loaded with this key and adds a reference to it, 0 if there is none
+		GLuint acquireTexture(uint64_t key);
+
+		//later loads with this key (a path or content hash and the load flags) reuse the texture
+		void addTextureKey(GLuint id, uint64_t key);
+
+		enum TextureSource
+		{
+			textureSourceNone = 0,
+			textureSourceFile,
+			textureSourcePaddedFile,
+			textureSourceBakedFile,
+		};
+
+		//where the texture is reloaded from after it was evicted by the texture memory budget
+		void setTextureSource(GLuint id, const char *fileName, TextureSource source, int blockSize,
+			bool pixelated, bool useMipMaps);
+
+		//called by the flush for every texture it draws, reloads evicted textures
+		void touchTexture(GLuint id);
+
+		//called after every flush, evicts the least recently drawn textures while over the budget
+		void evictTextures();
+
+		//the age of the textures is counted in frames, called by Renderer2D::updateWindowMetrics
+		void advanceTextureFrame();
+
+		//transforms the 4 vertices of a quad from pixels to screen coords (sprite rotation, camera, zoom)
+		using QuadTransformFunc = void(*)(glm::vec2 v[4], const glm::vec2 origin, const float rotation,
+			const Camera &camera, const float windowW, const float windowH);
+
+		//transforms already flipped points with the camera and converts them to screen coords
+		using PointTransformFunc = void(*)(glm::vec2 *v, const int count,
+			const Camera &camera, const float windowW, const float windowH);
 	}
 
 	///////////////////// COLOR ///////////////////
@@ -136,6 +267,26 @@ namespace gl2d
 	///////////////////// Texture /////////////////////
 #pragma region Texture
 
+	//Recorded by the texture registry when a gl2d texture is created, so sizes never have to be queried from gl.
+	struct TextureInfo
+	{
+		glm::ivec2 size = {};
+		GLenum internalFormat = 0;
+		int mipLevels = 1;
+		size_t bytes = 0; //all the mip levels, evicted textures keep their size and count only a 1x1 placeholder in the memory usage
+		int refCount = 1;
+	};
+
+	//returns nullptr for textures that weren't created by gl2d
+	const TextureInfo *getTextureInfo(GLuint id);
+
+	//the bytes of all the registered textures
+	size_t getTextureMemoryUsage();
+
+	int getTextureCount();
+
+	//Loading the same file (or the same file data) with the same flags returns the same texture
+	//and adds a reference to it. cleanup() deletes the gl texture when the last reference is dropped.
 	struct Texture
 	{
 		GLuint id = 0;
@@ -145,6 +296,7 @@ namespace gl2d
 			bool useMipMaps = GL2D_DEFAULT_TEXTURE_LOAD_MODE_USE_MIPMAPS)
 			{ loadFromFile(file, pixelated, useMipMaps); }
 
+		//read from the texture registry, only textures that weren't created by gl2d query gl
 		glm::ivec2 GetSize();
 
 		//Note: This function expects a buffer of bytes in GL_RGBA format
@@ -175,12 +327,21 @@ namespace gl2d
 		void loadFromFileWithPixelPadding(const char* fileName, int blockSize,
 			bool pixelated = GL2D_DEFAULT_TEXTURE_LOAD_MODE_PIXELATED, bool useMipMaps = GL2D_DEFAULT_TEXTURE_LOAD_MODE_USE_MIPMAPS);
 
+		//Loads a file made by bakeTexture. It is memory mapped and uploaded level by level,
+		//nothing is decoded, padded or generated on the gpu.
+		void loadFromBakedFile(const char* fileName, bool pixelated = GL2D_DEFAULT_TEXTURE_LOAD_MODE_PIXELATED);
+
 		void bind(const unsigned int sample = 0);
 		void unbind();
 
 		void cleanup();
 	};
 
+	//Offline step for Texture::loadFromBakedFile. Decodes the image, flips it, adds the pixel padding
+	//(same as loadFromFileWithPixelPadding, blockSize 0 means no padding) and builds the mip chain on the cpu.
+	//Returns false on fail.
+	bool bakeTexture(const char* imageFile, const char* bakedFile, int blockSize = 0, bool useMipMaps = true);
+
 #pragma endregion
 
 
@@ -229,12 +390,222 @@ namespace gl2d
 		}
 	};
 
+	//a sprite packed in a RuntimeAtlas, pass texture and uv to renderRectangle
+	struct AtlasSprite
+	{
+		Texture texture = {};
+		glm::vec4 uv = GL2D_DefaultTextureCoords;
+		glm::ivec2 size = {};
+	};
+
+	//Packs individually loaded images into shared pages (skyline packing) so different sprites don't break the batch.
+	//The edge pixels of every sprite are extruded into the padding so filtering doesn't bleed the neighbours in.
+	struct RuntimeAtlas
+	{
+		struct Page
+		{
+			Texture texture = {};
+			std::vector<glm::ivec3> skyline; //x, y, width of every segment, left to right
+		};
+
+		void create(int pageSize = 2048, int padding = 1,
+			bool pixelated = GL2D_DEFAULT_TEXTURE_LOAD_MODE_PIXELATED, bool useMipMaps = false);
+		void cleanup();
+
+		//Note: This function expects a buffer of bytes in GL_RGBA format, bottom row first like createFromBuffer
+		//Returns a sprite with no texture if the image doesn't fit in a page.
+		AtlasSprite add(const unsigned char *rgba, int width, int height);
+		AtlasSprite addFromFileData(const unsigned char *image_file_data, const size_t image_file_size);
+		AtlasSprite addFromFile(const char *fileName);
+
+		std::vector<Page> pages;
+		int pageSize = 2048;
+		int padding = 1;
+		bool pixelated = GL2D_DEFAULT_TEXTURE_LOAD_MODE_PIXELATED;
+		bool useMipMaps = false; //the mips are regenerated after every add
+
+	private:
+		//returns the skyline segment to place the rect at, -1 if it doesn't fit
+		int findPosition(const Page &page, glm::ivec2 size, glm::ivec2 &position);
+		void insert(Page &page, int segment, glm::ivec2 position, glm::ivec2 size);
+	};
+
+#pragma endregion
+
+
+	///////////////////// AsyncTextureLoader /////////////////////
+#pragma region AsyncTextureLoader
+
+	//Loads textures without stalling the frame.
+	//Files are read and decoded by a pool of worker threads, update() copies the pixels into a
+	//pixel unpack buffer on the gl thread within a time budget and then uploads them.
+	//load() returns right away a 1x1 white texture that becomes the image once it is uploaded (the id stays the same).
+	struct AsyncTextureLoader
+	{
+		//called from update() when the texture was uploaded or failed to load
+		using Callback = std::function<void(Texture texture, bool succeeded)>;
+
+		AsyncTextureLoader() {};
+		AsyncTextureLoader(const AsyncTextureLoader &) = delete;
+		AsyncTextureLoader &operator=(const AsyncTextureLoader &) = delete;
+		~AsyncTextureLoader() { stopWorkers(); }
+
+		void create(int workerCount = 2, float uploadBudgetMs = 2.f);
+
+		//textures that are still loading stay 1x1 white
+		void cleanup();
+
+		Texture load(const char *fileName, bool pixelated = GL2D_DEFAULT_TEXTURE_LOAD_MODE_PIXELATED,
+			bool useMipMaps = GL2D_DEFAULT_TEXTURE_LOAD_MODE_USE_MIPMAPS, Callback callback = {});
+
+		//Loads the file into an existing texture, it keeps its current content until the upload.
+		//Does nothing if the texture is already loading.
+		void reload(Texture texture, const char *fileName, bool pixelated = GL2D_DEFAULT_TEXTURE_LOAD_MODE_PIXELATED,
+			bool useMipMaps = GL2D_DEFAULT_TEXTURE_LOAD_MODE_USE_MIPMAPS, Callback callback = {});
+
+		//call it once per frame on the gl thread
+		void update();
+
+		bool isLoading(Texture texture);
+		int loadingCount() { return (int)loading.size(); }
+
+		float uploadBudgetMs = 2.f;
+
+	private:
+
+		struct Job
+		{
+			std::string fileName;
+			GLuint texture = 0;
+			unsigned int generation = 0; //of the texture when it was queued
+			bool pixelated = 0;
+			bool useMipMaps = 0;
+			Callback callback;
+
+			unsigned char *pixels = nullptr; //decoded by the workers, flipped for opengl
+			glm::ivec2 size = {};
+			size_t copiedBytes = 0;
+		};
+
+		void queue(GLuint texture, const char *fileName, bool pixelated, bool useMipMaps, Callback callback);
+		void workerLoop();
+		void stopWorkers();
+		void finishJob(Job *job, bool succeeded);
+		bool isStale(const Job *job);
+		void dropJob(Job *job);
+
+		std::vector<std::thread> workers;
+		std::mutex mutex;
+		std::condition_variable wake;
+		bool stopping = false;
+
+		//guarded by the mutex
+		std::deque<Job *> requests;
+		std::deque<Job *> decoded;
+
+		//gl thread only, the jobs are owned by the queues above and uploading
+		std::unordered_map<GLuint, Job *> loading;
+		Job *uploading = nullptr;
+		unsigned char *uploadMemory = nullptr; //the mapped pixel unpack buffer
+		GLuint pbo = 0;
+	};
+
+#pragma endregion
+
+
+	///////////////////// TextureResidency /////////////////////
+#pragma region TextureResidency
+
+	struct TextureResidencyStats
+	{
+		size_t budget = 0;
+		size_t usedBytes = 0; //all the registered textures, like getTextureMemoryUsage
+		int evictedTextures = 0; //currently evicted
+		uint64_t evictions = 0;
+		uint64_t reloads = 0;
+		uint64_t evictedBytes = 0;
+	};
+
+	//Textures loaded from files (loadFromFile, loadFromFileWithPixelPadding, loadFromBakedFile, AsyncTextureLoader)
+	//that weren't drawn recently are evicted, least recently drawn first, while the registered textures are over the budget.
+	//An evicted texture keeps its id and becomes 1x1 white, it is reloaded from its file the next time a flush draws it.
+	//0 (the default) means no budget.
+	void setTextureMemoryBudget(size_t bytes);
+
+	//Evicted textures are reloaded by this loader (on its worker threads) instead of synchronously, nullptr to disable.
+	//Only plain files, the padded and baked ones are always reloaded synchronously.
+	void setTextureReloadLoader(AsyncTextureLoader *loader);
+
+	TextureResidencyStats getTextureResidencyStats();
+
 #pragma endregion
 
 
 	///////////////////// Font /////////////////////
 #pragma region Font
 
+	//Outline and shadow of an sdf font, they are computed in the shader.
+	struct SDFFontStyle
+	{
+		Color4f   outlineColor = {0, 0, 0, 1};
+		float     outlineWidth = 0.f;             //in distance units, 0 to 0.5, 0 means no outline
+		Color4f   shadowColor = {0.1, 0.1, 0.1, 0}; //alpha 0 means no shadow
+		glm::vec2 shadowOffset = {-3, 2};          //in atlas pixels, keep it smaller than the padding
+		float     shadowSoftness = 0.1f;          //in distance units
+	};
+
+	//Glyphs outside of ' ' to '~' are rasterized the first time they are used into atlas pages.
+	//Pages are evicted least recently used first when they go over memoryBudget.
+	//Pages used since the last flush are never evicted since the draw data still uses them.
+	struct GlyphCache
+	{
+		struct Glyph
+		{
+			int page = -1; //-1 means the glyph has no pixels (spaces)
+			glm::vec4 quad = {}; //x0 y0 x1 y1 relative to the pen, in font pixels
+			glm::vec4 uv = {};
+		};
+
+		struct Page
+		{
+			Texture texture = {};
+			int shelfX = 0;
+			int shelfY = 0;
+			int shelfHeight = 0;
+			unsigned int lastUsedFlush = 0;
+			bool used = false;
+			std::vector<uint32_t> codepoints;
+		};
+
+		std::vector<unsigned char> ttfData;
+		stbtt_fontinfo info = {};
+		float scale = 0;
+		float metricsScale = 1;
+		int sdfPadding = 0; //in atlas pixels, 0 for bitmap fonts
+		GLuint fontTexture = 0; //sdf pages use the style of this font
+
+		int pageSize = 512;
+		size_t memoryBudget = GL2D_GLYPH_CACHE_BUDGET;
+
+		std::unordered_map<uint32_t, Glyph> glyphs;
+		std::vector<Page> pages; //evicted pages keep their texture and are reused
+
+		//rasterizes the glyph if needed, returns nullptr if the font doesn't have it
+		const Glyph *getGlyph(uint32_t codepoint);
+
+		//marks the page as used in this frame so it can't be evicted before the next flush
+		void touchPage(int page);
+
+		size_t getMemoryUsage();
+
+		void cleanup();
+
+	private:
+
+		int allocatePage();
+		void evictPage(int page);
+	};
+
 	//used to draw text
 	struct Font
 	{
@@ -244,12 +615,42 @@ namespace gl2d
 		int               packedCharsBufferSize = 0;
 		float             max_height = 0.f;
 
+		//signed distance field fonts, the glyph quads don't contain the padding
+		bool              sdf = false;
+		float             sdfPadding = 0.f;   //in font pixels
+		glm::vec2         sdfPaddingUV = {};
+		SDFFontStyle      sdfStyle = {};
+		glm::ivec2        sdfBake = {};        //bake height and padding in atlas pixels
+
+		//width of the ascii characters at size 1 (spaces and tabs like renderText draws them)
+		float            *advanceTable = nullptr;
+
+		//optional, shared by the copies of the font
+		GlyphCache       *glyphCache = nullptr;
+
 		Font() {}
 		explicit Font(const char *file) { createFromFile(file); }
 
 		void createFromTTF(const unsigned char *ttf_data, const size_t ttf_data_size);
 		void createFromFile(const char *file);
 
+		//Bakes a signed distance field atlas at bakeHeight pixels.
+		//It stays sharp at every size and supports outline and shadow (see setSDFStyle).
+		//The metrics are the same as createFromTTF so the text layout doesn't change.
+		void createSDFFromTTF(const unsigned char *ttf_data, const size_t ttf_data_size,
+			int bakeHeight = 40, int padding = 6);
+		void createSDFFromFile(const char *file, int bakeHeight = 40, int padding = 6);
+
+		//applies to all the text drawn with this font in the next flush
+		void setSDFStyle(const SDFFontStyle &style);
+
+		//Keeps a copy of the ttf so any unicode glyph can be rasterized when it is first drawn (utf-8 text).
+		//Call it after createFromTTF or createSDFFromTTF with the same data.
+		void createGlyphCache(const unsigned char *ttf_data, const size_t ttf_data_size,
+			size_t memoryBudget = GL2D_GLYPH_CACHE_BUDGET, int pageSize = 512);
+		void createGlyphCacheFromFile(const char *file,
+			size_t memoryBudget = GL2D_GLYPH_CACHE_BUDGET, int pageSize = 512);
+
 		void cleanup();
 	};
 
@@ -305,12 +706,15 @@ namespace gl2d
 	struct FrameBuffer
 	{
 		FrameBuffer() {};
-		explicit FrameBuffer(unsigned int w, unsigned int h) { create(w, h); };
+		explicit FrameBuffer(unsigned int w, unsigned int h, bool useDepth = false, GLenum internalFormat = GL_RGBA8)
+			{ create(w, h, useDepth, internalFormat); };
 
 		unsigned int fbo = 0;
 		Texture texture = {};
+		unsigned int depthBuffer = 0; //only created if useDepth is true, needed for the early z pass
+		GLenum internalFormat = GL_RGBA8; //GL_RGBA8, GL_R8 or GL_RGBA16F
 
-		void create(unsigned int w, unsigned int h);
+		void create(unsigned int w, unsigned int h, bool useDepth = false, GLenum internalFormat = GL_RGBA8);
 		void resize(unsigned int w, unsigned int h);
 
 		//clears resources
@@ -320,12 +724,184 @@ namespace gl2d
 		void clear();
 	};
 
+	//Transient FrameBuffers shared by the effects.
+	//acquire() hands out a free target with that size and format (or creates one) and release() gives it back,
+	//so effects that run one after the other use the same memory.
+	struct RenderTargetPool
+	{
+		FrameBuffer acquire(glm::ivec2 size, GLenum internalFormat = GL_RGBA8, bool useDepth = false);
+		void release(FrameBuffer frameBuffer);
+
+		//Call it once per frame (Renderer2D::updateWindowMetrics calls it for its pool).
+		//Releases everything that is still acquired and deletes the targets that weren't used for maxUnusedFrames frames.
+		void endFrame();
+
+		void cleanup();
+
+		size_t getMemoryUsage();
+
+		int maxUnusedFrames = 3;
+
+		struct Target
+		{
+			FrameBuffer frameBuffer = {};
+			glm::ivec2 size = {};
+			bool useDepth = 0;
+			bool inUse = 0;
+			int unusedFrames = 0;
+		};
+
+		std::vector<Target> targets;
+	};
+
+	struct Renderer2D;
+
+	//Creates the shader of a PostProcessPass, only the fragment shader is given.
+	//It gets "in vec2 v_texture;" (0 to 1) and "uniform sampler2D u_sampler;" (the input of the pass),
+	//and "uniform vec2 u_texelSize;" if it declares it.
+	ShaderProgram createPostProcessShader(const char *fragment);
+
+	struct PostProcessPass
+	{
+		ShaderProgram shader = {};
+
+		//of the window size, the last pass always draws at the window size
+		float resolutionScale = 1.f;
+		GLenum format = GL_RGBA8; //of the target it draws into
+
+		//more textures for the shader, bound from texture unit 1 to the sampler with that name
+		std::vector<std::pair<std::string, Texture>> inputs;
+
+		//called after the shader is bound, to set its own uniforms
+		std::function<void(GLuint program)> setUniforms;
+	};
+
+	//Fullscreen passes that run one after the other, every one reads the output of the one before.
+	//Each pass is one triangle that covers the target (no vertex buffer), the intermediate
+	//targets are ping ponged through renderer.renderTargets.
+	struct PostProcessChain
+	{
+		void addPass(ShaderProgram shader, float resolutionScale = 1.f, GLenum format = GL_RGBA8);
+
+		//Runs the passes on input. The last one draws into renderer.defaultFBO,
+		//alpha blended over it if blendOutput is true.
+		void render(Renderer2D &renderer, Texture input);
+
+		std::vector<PostProcessPass> passes;
+		bool blendOutput = true;
+	};
+
+
+	//Tracks the parts of the window that changed since the last frame (dirty rectangles).
+	//Every frame add the bounds (in window pixels) of everything that moves or changes.
+	//The damaged regions are the last and the current bounds of those objects,
+	//so only they have to be cleared and redrawn into a persistent FrameBuffer.
+	struct DamageTracker
+	{
+		std::vector<Rect> previousBounds;
+		std::vector<Rect> currentBounds;
+
+		//result of computeDamage, rects in whole window pixels that don't overlap each other
+		std::vector<Rect> damage;
+
+		//the next computeDamage will return the full window (first frame, resize, lost back buffer)
+		bool fullRedraw = true;
+
+		void addBounds(const Rect bounds) { currentBounds.push_back(bounds); }
+		void invalidate() { fullRedraw = true; }
+
+		//Merges the previous and current bounds into damage and returns it.
+		//Overlapping rects are merged. If the damage covers more than maxCoverage of the window
+		//it becomes a single full window rect since drawing everything is cheaper then.
+		//padding is added around every bound to account for antialiasing and rounding.
+		const std::vector<Rect> &computeDamage(int windowW, int windowH, float padding = 2.f, float maxCoverage = 0.5f);
+
+		//returns the bounding box of the damage
+		Rect getDamageBounds();
+
+		//call after the frame was drawn, the current bounds become the previous bounds
+		void endFrame();
+	};
+
+	//A camera and the part of the window it is drawn to. Used for split screen and minimaps.
+	struct RenderView
+	{
+		Camera camera = {};
+
+		//x y w h in window pixels (top left origin).
+		//The camera sees a viewport sized region, like a window of that size would.
+		glm::vec4 viewport = {};
+	};
+
+	//Keeps the glyph quads of recently rendered strings so unchanged text skips the layout.
+	//Entries are evicted least recently used first when more than maxGlyphs are stored.
+	struct TextLayoutCache
+	{
+		struct Glyph
+		{
+			glm::vec4 rect = {}; //relative to the text position
+			glm::vec4 uv = {};
+			GLuint texture = 0;
+			int page = -1; //glyph cache page, -1 for the font atlas
+		};
+
+		struct Entry
+		{
+			size_t hash = 0;
+			std::string text;
+			GLuint fontTexture = 0;
+			float size = 0;
+			float spacing = 0;
+			float lineSpace = 0;
+			bool center = 0;
+
+			std::vector<Glyph> glyphs;
+		};
+
+		//returns nullptr if the layout is not cached, a found entry becomes the most recently used
+		Entry *find(size_t hash, const char *text, size_t textLength, GLuint fontTexture,
+			float size, float spacing, float lineSpace, bool center);
+
+		//adds an empty entry (replacing one with the same hash), fill the glyphs and call trim
+		Entry &add(size_t hash, const char *text, size_t textLength, GLuint fontTexture,
+			float size, float spacing, float lineSpace, bool center);
+
+		//evicts the least recently used entries until the budget is respected
+		void trim();
+
+		//text size at size 1 (default spacing), every term of the text size scales with size
+		bool findUnitSize(size_t hash, const std::string &text, GLuint fontTexture, glm::vec2 &size);
+		void addUnitSize(size_t hash, const std::string &text, GLuint fontTexture, glm::vec2 size);
+
+		void clear();
+
+		size_t maxGlyphs = GL2D_TEXT_LAYOUT_CACHE_GLYPHS;
+		size_t glyphCount = 0;
+
+		//fonts can be recreated with the same texture id, the cache is cleared when this changes
+		unsigned int fontGeneration = 0;
+
+		std::list<Entry> entries; //front is the most recently used
+		std::unordered_map<size_t, std::list<Entry>::iterator> lookup;
+
+		struct UnitSize
+		{
+			std::string text;
+			GLuint fontTexture = 0;
+			glm::vec2 size = {};
+		};
+
+		//cleared when full
+		size_t maxUnitSizes = 1024;
+		std::unordered_map<size_t, UnitSize> unitSizes;
+	};
 
 	enum Renderer2DBufferType
 	{
 		quadPositions,
 		quadColors,
 		texturePositions,
+		clipRects,
 
 		bufferSize
 	};
@@ -355,12 +931,44 @@ namespace gl2d
 
 		GLuint buffers[Renderer2DBufferType::bufferSize] = {};
 		GLuint vao = {};
+		GLuint viewsBuffer = 0; //uniform buffer for flushMultiView, created on first use
 
-		//4 elements each component
+		//3 elements each component for every triangle (a quad is 2 triangles)
 		std::vector<glm::vec2>spritePositions;
 		std::vector<glm::vec4>spriteColors;
 		std::vector<glm::vec2>texturePositions;
+		//one texture for every triangle
 		std::vector<Texture>spriteTextures;
+		//clip rect of every vertex, in screen coords (min x, min y, max x, max y)
+		std::vector<glm::vec4>spriteClipRects;
+		//0 blended, 1 rendered with drawOpaque, 2 rendered with drawOpaque and no clip rect
+		std::vector<unsigned char>spriteOpaque;
+
+		//Opt in early z. When flushing, the triangles rendered with drawOpaque set are drawn first,
+		//front to back, with depth writes and no blending, then the rest are blended back to front.
+		//Large opaque sprites (backgrounds) will then hide what is behind them without shading it.
+		//Needs a depth buffer (the default framebuffer or a FrameBuffer created with useDepth),
+		//only works with the default shader and it is ignored by flushMultiView.
+		bool earlyZ = false;
+
+		//While this is true everything rendered is treated as fully opaque (used by earlyZ).
+		bool drawOpaque = false;
+
+		//the spriteOpaque value of the next triangle
+		unsigned char opaqueFlag() const { return !drawOpaque ? 0 : currentClipRect == GL2D_NoClipRect ? 2 : 1; }
+
+		//If true every flush counts the shaded samples with an occlusion query.
+		//lastOverdraw is the samples of the last finished flush divided by the area it was drawn to
+		//(1 means every pixel was shaded once). It is read one flush later so the gpu is not stalled.
+		bool reportOverdraw = false;
+		float lastOverdraw = 0;
+		GLuint overdrawQueries[2] = {};
+		bool overdrawQueryIssued[2] = {};
+		float overdrawQueryArea[2] = {}; //the viewport area of the flush of every query
+		int overdrawQueryIndex = 0;
+
+		//scratch buffer used by renderMesh
+		std::vector<glm::vec2>meshTransformedPositions;
 		
 		//glm::vec2 spritePositions[GL2D_Renderer2D_Max_Triangle_Capacity * 6];
 		//glm::vec4 spriteColors[GL2D_Renderer2D_Max_Triangle_Capacity * 6];
@@ -382,13 +990,36 @@ namespace gl2d
 		void pushCamera(Camera c = {});
 		void popCamera();
 
+		//The quad transform kernels are picked once per camera rotation/zoom change
+		//(index 0 is for not rotated sprites, 1 for rotated ones).
+		//This is updated automatically, even if currentCamera is written directly.
+		internal::QuadTransformFunc quadTransforms[2] = {};
+		internal::PointTransformFunc pointTransform = {};
+		float pipelineCameraRotation = 0.f;
+		float pipelineCameraZoom = 1.f;
+		void updateTransformPipeline();
+
+		//Everything rendered is clipped to the current clip rect.
+		//The clipping is done in the shader so changing the clip rect doesn't break the batch.
+		//The rect is in window pixels (not affected by the camera) and it is intersected with the previous one.
+		//Call updateWindowMetrics before pushing a clip rect.
+		//Note: custom shaders have to discard the fragments themselves (see the default shader)
+		glm::vec4 currentClipRect = GL2D_NoClipRect;
+		std::vector<glm::vec4> clipRectPushPop;
+		void pushClipRect(const Rect clip);
+		void popClipRect();
+
 		glm::vec4 getViewRect(); //returns the view coordonates and size of this camera. Doesn't take rotation into account!
 
 
 		//window metrics, should be up to date at all times
 		int windowW = -1;
 		int windowH = -1;
-		void updateWindowMetrics(int w, int h) { windowW = w; windowH = h; }
+
+		//Call it once per frame, before rendering. It also ends the frame of renderTargets,
+		//so the targets of an old size (window resize) are deleted after a few frames,
+		//and advances the frame the texture residency measures the age of the textures in.
+		void updateWindowMetrics(int w, int h) { windowW = w; windowH = h; renderTargets.endFrame(); internal::advanceTextureFrame(); }
 
 		//converts pixels to screen (top left) (bottom right)
 		glm::vec4 toScreen(const glm::vec4& transform);
@@ -400,6 +1031,8 @@ namespace gl2d
 			spriteColors.clear();
 			texturePositions.clear();
 			spriteTextures.clear();
+			spriteClipRects.clear();
+			spriteOpaque.clear();
 
 			//spritePositionsCount = 0;
 			//spriteColorsCount = 0;
@@ -410,8 +1043,19 @@ namespace gl2d
 		glm::vec2 getTextSize(const char *text, const Font font, const float size = 1.5f,
 			const float spacing = 4, const float line_space = 3);
 
+		//layouts of the recently drawn strings, used by renderText
+		TextLayoutCache textLayoutCache;
+
+		//transient targets for the effects that render with this renderer (like ParticleSystem)
+		RenderTargetPool renderTargets;
+
+		//getTextSize at size 1 with the default spacing, memoized.
+		//Used by the determineTextRescaleFit functions so fitting the same text again is O(1).
+		glm::vec2 getTextSizeUnit(const std::string &text, const Font &font);
+
 		// The origin will be the bottom left corner since it represents the line for the text to be drawn
 		//Pacing and lineSpace are influenced by size
+		//Sdf fonts ignore ShadowColor and LightColor, they use the font style instead
 		//todo the function should returns the size of the text drawn also refactor
 		void renderText(glm::vec2 position, const char *text, const Font font, const Color4f color, const float size = 1.5f,
 			const float spacing = 4, const float line_space = 3, bool showInCenter = 1, const Color4f ShadowColor = {0.1,0.1,0.1,1}
@@ -430,7 +1074,17 @@ namespace gl2d
 		//returns number of lines
 		//out rez is optional
 		int wrap(const std::string &in, gl2d::Font &f,
-			float baseSize, float maxDimension, std::string *outRez);
+			float baseSize, float maxDimension, std::string *outRez, float spacing = 4);
+
+		//Finds where the text has to wrap so the lines are shorter than maxDimension, in one pass without allocating.
+		//Writes the byte positions where a new line starts into breaks (at most maxBreaks, breaks can be null).
+		//Returns the number of breaks, it can be bigger than maxBreaks.
+		int wrapBreaks(const char *text, const size_t textLength, const gl2d::Font &f,
+			float baseSize, float maxDimension, int *breaks, int maxBreaks, float spacing = 4);
+
+		//reused by wrap and the wrapped text functions so they don't allocate every frame
+		std::vector<int> wrapBreakBuffer = std::vector<int>(64);
+		std::string wrapScratch;
 
 		// The origin will be the bottom left corner since it represents the line for the text to be drawn
 		//Pacing and lineSpace are influenced by size
@@ -478,6 +1132,22 @@ namespace gl2d
 			renderRectangleAbsRotation(transforms, c, origin, rotationDegrees);
 		}
 
+		//The points are in pixels, like the rectangles. They are batched together with the rectangles.
+		//texture coords can be null.
+		void renderTriangle(const glm::vec2 points[3], const Texture texture, const Color4f colors[3], const glm::vec2 textureCoords[3]);
+		void renderTriangle(const glm::vec2 p1, const glm::vec2 p2, const glm::vec2 p3, const Color4f color);
+
+		//the polygon must be convex, it is drawn as a triangle fan from the first point.
+		//max GL2D_MAX_POLYGON_POINTS points, texture coords can be null.
+		void renderConvexPolygon(const glm::vec2 *points, const int count, const Texture texture, const Color4f *colors, const glm::vec2 *textureCoords);
+		void renderConvexPolygon(const glm::vec2 *points, const int count, const Color4f color);
+
+		//Renders an indexed triangle list, every 3 indices are a triangle.
+		//Colors and texture coords are per vertex and can be null (white and no texture).
+		//A texture with id 0 means no texture.
+		void renderMesh(const glm::vec2 *positions, const Color4f *colors, const glm::vec2 *textureCoords,
+			const int vertexCount, const unsigned int *indices, const int indexCount, const Texture texture = {});
+
 		void renderLine(const glm::vec2 position, const float angleDegrees, const float length, const Color4f color, const float width = 2.f);
 
 		void renderLine(const glm::vec2 start, const glm::vec2 end, const Color4f color, const float width = 2.f);
@@ -505,9 +1175,54 @@ namespace gl2d
 		//Usefull if you want to render something twice or render again on top for some reason
 		void flush(bool clearDrawData = true);
 
+		//Draws everything once for every view in a single pass (instanced over the views).
+		//Record the scene once with the default camera (pushCamera()), the cameras of the views are applied on the gpu.
+		//Each view is clipped to its viewport, the clip rects and the current shader are not used.
+		//Max GL2D_MAX_VIEWS views.
+		void flushMultiView(const RenderView *views, const int viewCount, bool clearDrawData = true);
+
 		//Renders to a fbo instead of the screen. The fbo is just a texture.
 		//If clearDrawData is false, the rendering information will be kept.
 		void flushFBO(FrameBuffer frameBuffer, bool clearDrawData = true);
+
+		//Renders to a fbo using only viewportSize pixels of it.
+		//The coordinates are still in window pixels so the scene is drawn scaled down (or up).
+		void flushFBO(FrameBuffer frameBuffer, glm::ivec2 viewportSize, bool clearDrawData = true);
+	};
+
+	//Renders the scene into a scaled FrameBuffer and stretches it over the window.
+	//The scale is adjusted using the measured gpu time (timer queries) to hold targetFrameMs.
+	//The results are read a few frames later so the gpu is never stalled.
+	struct DynamicResolution
+	{
+		void create(float targetFrameMs = 16.f, float minScale = 0.5f, float maxScale = 1.f);
+		void cleanup();
+
+		//Use this instead of renderer.flush() for the scene. It replaces the content of the window
+		//(the scaled buffer is cleared with the current glClearColor). Ui can be flushed after at full resolution.
+		void flush(Renderer2D &renderer);
+
+		float targetFrameMs = 16.f; //gpu time budget for the scene
+		float minScale = 0.5f;
+		float maxScale = 1.f;
+		float scale = 1.f;
+
+		//the gpu time has to be outside of targetFrameMs * (1 +- hysteresis) to change the scale
+		float hysteresis = 0.15f;
+		float scaleStep = 0.05f;
+		int cooldownFrames = 30; //min frames between 2 scale changes
+
+		float lastGpuMs = 0;
+
+		FrameBuffer fb = {};
+		glm::ivec2 fbSize = {};
+
+		GLuint queries[GL2D_DYNAMIC_RESOLUTION_QUERIES] = {};
+		bool queryIssued[GL2D_DYNAMIC_RESOLUTION_QUERIES] = {};
+		int queryIndex = 0;
+		int framesSinceChange = 0;
+
+		void updateScale();
 	};
 
 	void enableNecessaryGLFeatures();
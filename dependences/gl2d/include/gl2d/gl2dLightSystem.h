@@ -0,0 +1,70 @@
+#pragma once
+#include "gl2d.h"
+
+namespace gl2d
+{
+
+	///////////////////// LightSystem /////////////////////
+#pragma region LightSystem
+
+	void initgl2dLightSystem();
+
+	void cleanupgl2dLightSystem();
+
+	struct PointLight
+	{
+		glm::vec2 position = {};
+		float radius = 100;
+		float intensity = 1;
+		glm::vec3 color = {1,1,1};
+	};
+
+	//Accumulates point lights into a reduced resolution light buffer and multiplies it over the scene.
+	//The screen is split in tiles and every light is binned into the tiles it touches (on the cpu),
+	//so every pixel only evaluates the lights near it.
+	struct LightSystem
+	{
+		void create(float resolutionScale = 0.5f, int tileSize = 16);
+		void cleanup();
+
+		//positions and radius are in world pixels, like the renderer
+		void addLight(glm::vec2 position, float radius, glm::vec3 color = {1,1,1}, float intensity = 1);
+		void addLight(const PointLight &light);
+		void clearLights();
+
+		//Renders the lights seen by renderer.currentCamera and multiplies them over renderer.defaultFBO.
+		//Call it after the scene was flushed and before the ui.
+		//The light buffer can brighten the scene up to 2x.
+		void render(Renderer2D &renderer);
+
+		glm::vec3 ambient = {0.2f, 0.2f, 0.25f};
+		float resolutionScale = 0.5f;
+		int tileSize = 16; //in light buffer pixels
+
+		std::vector<PointLight> lights;
+
+		FrameBuffer fb = {};
+
+	private:
+
+		glm::ivec2 fbSize = {};
+
+		GLuint vao = 0;
+
+		//buffer textures read with texelFetch
+		GLuint lightsBuffer = 0;
+		GLuint lightsTexture = 0;
+		GLuint tilesBuffer = 0;
+		GLuint tilesTexture = 0;
+		GLuint indicesBuffer = 0;
+		GLuint indicesTexture = 0;
+
+		std::vector<glm::vec4> lightData; //2 texels per light: position radius intensity, color
+		std::vector<glm::ivec2> tileRanges; //first index, count
+		std::vector<int> tileIndices;
+		std::vector<int> tileCounters;
+	};
+
+#pragma endregion
+
+}
@@ -11,6 +11,26 @@ namespace gl2d
 	
 	void cleanupgl2dParticleSystem();
 
+	//The vector loops of ParticleSystem::applyMovement. The widest one the cpu supports is picked
+	//the first time it is used (sse2, avx2 or avx512 on x86, scalar everywhere else).
+	//They all give the same results as the scalar one, bit for bit.
+	struct ParticleSimdBackend
+	{
+		const char *name;
+		int width; //floats per vector
+
+		//value[i] += deltaTime * rate[i]
+		void (*integrate)(float *value, const float *rate, float deltaTime, int count);
+
+		//decrements the positive durations, writes the indices of the dead particles (duration <= 0) and returns their count
+		int (*updateLifetimes)(float *duration, float deltaTime, int count, int *dead);
+	};
+
+	const ParticleSimdBackend &getParticleSimdBackend();
+
+	//"scalar", "sse2", "avx2" or "avx512", returns false if it isn't available on this cpu
+	bool setParticleSimdBackend(const char *name);
+
 	struct ParticleApearence
 	{
 		glm::vec2 size = {};
@@ -77,10 +97,23 @@ namespace gl2d
 		bool postProcessing = true;
 		float pixelateFactor = 2;
 
+		//for runs that have to be repeated exactly (tests, replays)
+		void seedRandom(unsigned int seed) { random.seed(seed); }
+
+		int getAliveCount() { return aliveCount; }
+
+		//position x y, rotation and the duration left of the alive particle i
+		glm::vec4 getParticleState(int i) { return {posX[i], posY[i], rotation[i], duration[i]}; }
+
 	private:
 
 		int size = 0;
 
+		//the alive particles are [0, aliveCount), dead ones are swapped with the last alive one
+		int aliveCount = 0;
+
+		int *deadIndices = 0; //filled by applyMovement
+
 		float *posX = 0;
 		float *posY = 0;
 
@@ -113,9 +146,9 @@ namespace gl2d
 
 		std::mt19937 random{std::random_device{}()};
 
-		gl2d::FrameBuffer fb = {};
-
 		float rand(glm::vec2 v);
+
+		void removeParticle(int i);
 	};
 
 
@@ -70,12 +70,18 @@
 
 #ifdef _WIN32
 #include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 #include <fstream>
 #include <sstream>
 #include <algorithm>
 #include <iostream>
+#include <chrono>
 
 //if you are not using visual studio make shure you link to "Opengl32.lib"
 #ifdef _MSC_VER
@@ -101,16 +107,42 @@ namespace gl2d
 		"in vec2 quad_positions;\n"
 		"in vec4 quad_colors;\n"
 		"in vec2 texturePositions;\n"
+		"in vec4 clip_rect;\n"
 		"out vec4 v_color;\n"
 		"out vec2 v_texture;\n"
+		"out vec2 v_position;\n"
+		"flat out vec4 v_clip;\n"
+		"uniform float u_depthStep;\n" //used by the early z pass, later triangles are closer
 		"void main()\n"
 		"{\n"
-		"	gl_Position = vec4(quad_positions, 0, 1);\n"
+		"	gl_Position = vec4(quad_positions, 1.0 - 2.0 * float(gl_VertexID / 3 + 1) * u_depthStep, 1);\n"
 		"	v_color = quad_colors;\n"
 		"	v_texture = texturePositions;\n"
+		"	v_position = quad_positions;\n"
+		"	v_clip = clip_rect;\n"
 		"}\n";
 
+	//the clip rect is in screen coords (min x, min y, max x, max y)
 	static const char* defaultFragmentShader =
+		GL2D_OPNEGL_SHADER_VERSION "\n"
+		GL2D_OPNEGL_SHADER_PRECISION "\n"
+		"out vec4 color;\n"
+		"in vec4 v_color;\n"
+		"in vec2 v_texture;\n"
+		"in vec2 v_position;\n"
+		"flat in vec4 v_clip;\n"
+		"uniform sampler2D u_sampler;\n"
+		"void main()\n"
+		"{\n"
+		"    if (any(lessThan(v_position, v_clip.xy)) || any(greaterThan(v_position, v_clip.zw))) discard;\n"
+		"    color = v_color * texture2D(u_sampler, v_texture);\n"
+		"}\n";
+
+	//Used by the opaque pass of the early z flush for the triangles without a clip rect.
+	//It can't discard, so the gpu can keep the depth test before the fragment shader.
+	static ShaderProgram opaqueShader = {};
+
+	static const char* opaqueFragmentShader =
 		GL2D_OPNEGL_SHADER_VERSION "\n"
 		GL2D_OPNEGL_SHADER_PRECISION "\n"
 		"out vec4 color;\n"
@@ -122,6 +154,149 @@ namespace gl2d
 		"    color = v_color * texture2D(u_sampler, v_texture);\n"
 		"}\n";
 
+	//Used for the texture runs of sdf fonts. The glyph is the 0.5 edge of the distance field,
+	//the outline and the shadow are further out in the padding.
+	static const char *sdfFragmentShader =
+		GL2D_OPNEGL_SHADER_VERSION "\n"
+		GL2D_OPNEGL_SHADER_PRECISION "\n"
+		R"(out vec4 color;
+		in vec4 v_color;
+		in vec2 v_texture;
+		in vec2 v_position;
+		flat in vec4 v_clip;
+		uniform sampler2D u_sampler;
+		uniform vec4 u_outlineColor;
+		uniform float u_outlineWidth;
+		uniform vec4 u_shadowColor;
+		uniform vec2 u_shadowOffset;
+		uniform float u_shadowSoftness;
+
+		vec4 over(vec4 a, vec4 b)
+		{
+			float alpha = a.a + b.a * (1.0 - a.a);
+			vec3 c = (a.rgb * a.a + b.rgb * b.a * (1.0 - a.a)) / max(alpha, 0.0001);
+			return vec4(c, alpha);
+		}
+
+		void main()
+		{
+			if (any(lessThan(v_position, v_clip.xy)) || any(greaterThan(v_position, v_clip.zw))) discard;
+
+			float d = texture(u_sampler, v_texture).r;
+			float w = max(fwidth(d), 0.0001);
+
+			float fill = smoothstep(0.5 - w, 0.5 + w, d);
+			vec4 c = vec4(v_color.rgb, v_color.a * fill);
+
+			if (u_outlineWidth > 0.0)
+			{
+				float edge = 0.5 - u_outlineWidth;
+				float outline = smoothstep(edge - w, edge + w, d);
+				c = over(c, vec4(u_outlineColor.rgb, u_outlineColor.a * v_color.a * outline));
+			}
+
+			if (u_shadowColor.a > 0.0)
+			{
+				vec2 offset = u_shadowOffset / vec2(textureSize(u_sampler, 0));
+				float sd = texture(u_sampler, v_texture - offset).r;
+				float edge = 0.5 - max(u_outlineWidth, 0.0);
+				float shadow = smoothstep(edge - u_shadowSoftness - w, edge + u_shadowSoftness + w, sd);
+				c = over(c, vec4(u_shadowColor.rgb, u_shadowColor.a * v_color.a * shadow));
+			}
+
+			color = c;
+		})";
+
+	static ShaderProgram multiViewShader = {};
+
+	//Used by flushMultiView. The scene is recorded once (with the default camera)
+	//and every instance draws it for one view. The camera of the view is applied here
+	//the same way the cpu does it for the normal flush.
+	static const char *multiViewVertexShader =
+		GL2D_OPNEGL_SHADER_VERSION "\n"
+		GL2D_OPNEGL_SHADER_PRECISION "\n"
+		"#define MAX_VIEWS " GL2D_STRINGIFY(GL2D_MAX_VIEWS) "\n"
+		R"(in vec2 quad_positions;
+		in vec4 quad_colors;
+		in vec2 texturePositions;
+		out vec4 v_color;
+		out vec2 v_texture;
+		out vec2 v_position;
+		flat out vec4 v_clip;
+
+		layout(std140) uniform gl2d_Views
+		{
+			vec4 u_viewCamera[MAX_VIEWS]; //position x y, rotation (radians), zoom
+			vec4 u_viewport[MAX_VIEWS];   //x y w h in window pixels
+			vec4 u_target;                //window w h
+		};
+
+		void main()
+		{
+			vec4 camera = u_viewCamera[gl_InstanceID];
+			vec4 viewport = u_viewport[gl_InstanceID];
+			vec2 target = u_target.xy;
+
+			//back to world pixels, y is flipped like in the cpu transform
+			vec2 p = vec2((quad_positions.x + 1.0) * 0.5 * target.x, (quad_positions.y - 1.0) * 0.5 * target.y);
+
+			p.x -= camera.x;
+			p.y += camera.y;
+
+			vec2 center = vec2(viewport.z / 2.0, -viewport.w / 2.0);
+			float s = sin(camera.z);
+			float c = cos(camera.z);
+			p -= center;
+			p = vec2(p.x * c - p.y * s, p.x * s + p.y * c);
+			p = p * camera.w + center;
+
+			//view pixels to window screen coords
+			p.x += viewport.x;
+			p.y -= viewport.y;
+			p = vec2(p.x / target.x * 2.0 - 1.0, p.y / target.y * 2.0 + 1.0);
+
+			gl_Position = vec4(p, 0, 1);
+			v_color = quad_colors;
+			v_texture = texturePositions;
+			v_position = p;
+			v_clip = vec4(viewport.x / target.x * 2.0 - 1.0, 1.0 - (viewport.y + viewport.w) / target.y * 2.0,
+				(viewport.x + viewport.z) / target.x * 2.0 - 1.0, 1.0 - viewport.y / target.y * 2.0);
+		})";
+
+	struct SDFShader
+	{
+		ShaderProgram program = {};
+		int u_outlineColor = -1;
+		int u_outlineWidth = -1;
+		int u_shadowColor = -1;
+		int u_shadowOffset = -1;
+		int u_shadowSoftness = -1;
+	};
+
+	//0 is used with the default shader, 1 with the multi view shader
+	static SDFShader sdfShaders[2] = {};
+
+	//sdf font textures and their style
+	static std::unordered_map<GLuint, SDFFontStyle> sdfFonts;
+
+	//one triangle that covers the target, generated from gl_VertexID so no vertex buffer is needed
+	static const char *postProcessVertexShader =
+		GL2D_OPNEGL_SHADER_VERSION "\n"
+		GL2D_OPNEGL_SHADER_PRECISION "\n"
+		"out vec2 v_texture;\n"
+		"void main()\n"
+		"{\n"
+		"	vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+		"	v_texture = p;\n"
+		"	gl_Position = vec4(p * 2.0 - 1.0, 0, 1);\n"
+		"}\n";
+
+	//empty, the core profile needs one bound to draw
+	static GLuint fullScreenVao = 0;
+
+	//incremented after every flush, glyph cache pages used in the current one can't be evicted
+	static unsigned int flushCounter = 1;
+
 #pragma endregion
 
 	static errorFuncType* errorFunc = defaultErrorFunc;
@@ -144,6 +319,11 @@ namespace gl2d
 		return a;
 	}
 
+	void internal::reportError(const char *msg)
+	{
+		errorFunc(msg, userDefinedData);
+	}
+
 	namespace internal
 	{
 		float positionToScreenCoordsX(const float position, float w)
@@ -180,6 +360,75 @@ namespace gl2d
 			return glm::vec4{quad.s0, quad.t0, quad.s1, quad.t1};
 		}
 
+		bool fontGetGlyph(const Font &font, const uint32_t codepoint, FontGlyph &out)
+		{
+			if (codepoint >= ' ' && codepoint <= '~')
+			{
+				const stbtt_aligned_quad quad = fontGetGlyphQuad(font, (char)codepoint);
+				out.quad = {quad.x0, quad.y0, quad.x1, quad.y1};
+				out.uv = {quad.s0, quad.t0, quad.s1, quad.t1};
+				out.uvPadding = font.sdfPaddingUV;
+				out.texture = font.texture.id;
+				out.page = -1;
+				return true;
+			}
+
+			if (!font.glyphCache)
+			{
+				return false;
+			}
+
+			auto glyph = font.glyphCache->getGlyph(codepoint);
+			if (!glyph)
+			{
+				return false;
+			}
+
+			out.quad = glyph->quad;
+			out.uv = glyph->uv;
+			out.uvPadding = glm::vec2((float)font.glyphCache->sdfPadding / font.glyphCache->pageSize);
+			out.page = glyph->page;
+			out.texture = glyph->page >= 0 ? font.glyphCache->pages[glyph->page].texture.id : 0;
+			return true;
+		}
+
+		uint32_t decodeUTF8(const char *&text, const char *end)
+		{
+			const unsigned char c = (unsigned char)*text++;
+
+			if (c < 0x80)
+			{
+				return c;
+			}
+
+			int extra = 0;
+			uint32_t codepoint = 0;
+
+			if ((c & 0xE0) == 0xC0) { extra = 1; codepoint = c & 0x1F; }
+			else if ((c & 0xF0) == 0xE0) { extra = 2; codepoint = c & 0x0F; }
+			else if ((c & 0xF8) == 0xF0) { extra = 3; codepoint = c & 0x07; }
+			else { return 0xFFFD; }
+
+			for (int i = 0; i < extra; i++)
+			{
+				if (text >= end || ((unsigned char)*text & 0xC0) != 0x80)
+				{
+					return 0xFFFD;
+				}
+
+				codepoint = (codepoint << 6) | ((unsigned char)*text++ & 0x3F);
+			}
+
+			//overlong encodings and surrogates
+			static const uint32_t minimum[4] = {0, 0x80, 0x800, 0x10000};
+			if (codepoint < minimum[extra] || codepoint > 0x10FFFF || (codepoint >= 0xD800 && codepoint <= 0xDFFF))
+			{
+				return 0xFFFD;
+			}
+
+			return codepoint;
+		}
+
 		GLuint loadShader(const char* source, GLenum shaderType)
 		{
 			GLuint id = glCreateShader(shaderType);
@@ -251,8 +500,27 @@ namespace gl2d
 	#endif
 
 		defaultShader = createShaderProgram(defaultVertexShader, defaultFragmentShader);
+		opaqueShader = createShaderProgram(defaultVertexShader, opaqueFragmentShader);
+		multiViewShader = createShaderProgram(multiViewVertexShader, defaultFragmentShader);
+		glUniformBlockBinding(multiViewShader.id,
+			glGetUniformBlockIndex(multiViewShader.id, "gl2d_Views"), GL2D_VIEWS_UNIFORM_BINDING);
+
+		for (int i = 0; i < 2; i++)
+		{
+			auto &sdf = sdfShaders[i];
+			sdf.program = createShaderProgram(i ? multiViewVertexShader : defaultVertexShader, sdfFragmentShader);
+			sdf.u_outlineColor = glGetUniformLocation(sdf.program.id, "u_outlineColor");
+			sdf.u_outlineWidth = glGetUniformLocation(sdf.program.id, "u_outlineWidth");
+			sdf.u_shadowColor = glGetUniformLocation(sdf.program.id, "u_shadowColor");
+			sdf.u_shadowOffset = glGetUniformLocation(sdf.program.id, "u_shadowOffset");
+			sdf.u_shadowSoftness = glGetUniformLocation(sdf.program.id, "u_shadowSoftness");
+		}
+		glUniformBlockBinding(sdfShaders[1].program.id,
+			glGetUniformBlockIndex(sdfShaders[1].program.id, "gl2d_Views"), GL2D_VIEWS_UNIFORM_BINDING);
 		white1pxSquareTexture.create1PxSquare();
 
+		glGenVertexArrays(1, &fullScreenVao);
+
 		enableNecessaryGLFeatures();
 	}
 
@@ -260,6 +528,12 @@ namespace gl2d
 	{
 		white1pxSquareTexture.cleanup();
 		glDeleteShader(defaultShader.id);
+		glDeleteProgram(opaqueShader.id);
+		glDeleteProgram(multiViewShader.id);
+		glDeleteProgram(sdfShaders[0].program.id);
+		glDeleteProgram(sdfShaders[1].program.id);
+		glDeleteVertexArrays(1, &fullScreenVao);
+		fullScreenVao = 0;
 		hasInitialized = false;
 	}
 
@@ -318,6 +592,7 @@ namespace gl2d
 		glBindAttribLocation(shader.id, 0, "quad_positions");
 		glBindAttribLocation(shader.id, 1, "quad_colors");
 		glBindAttribLocation(shader.id, 2, "texturePositions");
+		glBindAttribLocation(shader.id, 3, "clip_rect");
 
 		glLinkProgram(shader.id);
 
@@ -346,6 +621,7 @@ namespace gl2d
 		glValidateProgram(shader.id);
 
 		shader.u_sampler = glGetUniformLocation(shader.id, "u_sampler");
+		shader.u_depthStep = glGetUniformLocation(shader.id, "u_depthStep");
 
 		return shader;
 	}
@@ -387,700 +663,1992 @@ namespace gl2d
 	///////////////////// Font /////////////////////
 #pragma	region Font
 
-	void Font::createFromTTF(const unsigned char *ttf_data, const size_t ttf_data_size)
-	{
-		size.x = 2000,
-		size.y = 2000,
-		max_height = 0,
-		packedCharsBufferSize = ('~' - ' ');
-
-		//STB TrueType will give us a one channel buffer of the font that we then convert to RGBA for OpenGL
-		const size_t fontMonochromeBufferSize = size.x * size.y;
-		const size_t fontRgbaBufferSize = size.x * size.y * 4;
-
-		unsigned char *fontMonochromeBuffer = new unsigned char[fontMonochromeBufferSize];
-		unsigned char *fontRgbaBuffer = new unsigned char[fontRgbaBufferSize];
+	//changes whenever a font is created or deleted, invalidates the text layout caches
+	static unsigned int fontGeneration = 1;
 
-		packedCharsBuffer = new stbtt_packedchar[packedCharsBufferSize]{};
-
-		stbtt_pack_context stbtt_context;
-		stbtt_PackBegin(&stbtt_context, fontMonochromeBuffer, size.x, size.y, 0, 2, NULL);
-		stbtt_PackSetOversampling(&stbtt_context, 2, 2);
-		stbtt_PackFontRange(&stbtt_context, ttf_data, 0, 65, ' ', '~' - ' ', packedCharsBuffer);
-		stbtt_PackEnd(&stbtt_context);
+	//max height and the advance table, needs the packed chars
+	static void computeFontMetrics(Font &font)
+	{
+		font.max_height = 0;
 
-		for (int i = 0; i < fontMonochromeBufferSize; i++)
+		for (char c = ' '; c <= '~'; c++)
 		{
+			const stbtt_aligned_quad  q = internal::fontGetGlyphQuad(font, c);
+			const float               m = q.y1 - q.y0;
 
-			fontRgbaBuffer[(i * 4)] = fontMonochromeBuffer[i];
-			fontRgbaBuffer[(i * 4) + 1] = fontMonochromeBuffer[i];
-			fontRgbaBuffer[(i * 4) + 2] = fontMonochromeBuffer[i];
-
-			if (fontMonochromeBuffer[i] > 1)
-			{
-				fontRgbaBuffer[(i * 4) + 3] = 255;
-			}
-			else
+			if (m > font.max_height && m < 1.e+8f)
 			{
-				fontRgbaBuffer[(i * 4) + 3] = 0;
+				font.max_height = m;
 			}
 		}
 
-		//Init texture
-		{
-			glGenTextures(1, &texture.id);
-			glBindTexture(GL_TEXTURE_2D, texture.id);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, fontRgbaBuffer);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		delete[] font.advanceTable;
+		font.advanceTable = new float[128]{};
 
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		for (int c = ' '; c <= '~'; c++)
+		{
+			const stbtt_aligned_quad q = internal::fontGetGlyphQuad(font, (char)c);
+			font.advanceTable[c] = q.x1 - q.x0;
 		}
 
-		delete[] fontMonochromeBuffer;
-		delete[] fontRgbaBuffer;
+		//the same widths renderText uses for spaces and tabs
+		font.advanceTable[' '] = font.advanceTable['_'];
+		font.advanceTable['\t'] = font.advanceTable['_'] * 3;
+	}
 
-		for (char c = ' '; c <= '~'; c++)
+	namespace internal
+	{
+		bool MappedFile::open(const char *path)
 		{
-			const stbtt_aligned_quad  q = internal::fontGetGlyphQuad(*this, c);
-			const float               m = q.y1 - q.y0;
+			close();
 
-			if (m > max_height && m < 1.e+8f)
-			{
-				max_height = m;
-			}
+		#ifdef _WIN32
+			file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+			if (file == INVALID_HANDLE_VALUE) { return false; }
+
+			LARGE_INTEGER fileSize = {};
+			if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) { close(); return false; }
+
+			mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (!mapping) { close(); return false; }
+
+			data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (!data) { close(); return false; }
+
+			size = (size_t)fileSize.QuadPart;
+		#else
+			fd = ::open(path, O_RDONLY);
+			if (fd < 0) { return false; }
+
+			struct stat info = {};
+			if (fstat(fd, &info) != 0 || info.st_size == 0) { close(); return false; }
+
+			void *mapped = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (mapped == MAP_FAILED) { close(); return false; }
+
+			data = (const unsigned char *)mapped;
+			size = (size_t)info.st_size;
+		#endif
+
+			return true;
 		}
 
-	}
+		void MappedFile::close()
+		{
+		#ifdef _WIN32
+			if (data) { UnmapViewOfFile(data); }
+			if (mapping) { CloseHandle(mapping); }
+			if (file != INVALID_HANDLE_VALUE) { CloseHandle(file); }
+			mapping = NULL;
+			file = INVALID_HANDLE_VALUE;
+		#else
+			if (data) { munmap((void *)data, size); }
+			if (fd >= 0) { ::close(fd); }
+			fd = -1;
+		#endif
 
-	void Font::createFromFile(const char *file)
-	{
-		std::ifstream fileFont(file, std::ios::binary);
+			data = nullptr;
+			size = 0;
+		}
 
-		if (!fileFont.is_open())
+		uint64_t hashFNV1a(const void *data, const size_t size, uint64_t hash)
 		{
-			char c[300] = {0};
-			strcat(c, "error openning: ");
-			strcat(c + strlen(c), file);
-			errorFunc(c, userDefinedData);
-			return;
+			auto bytes = (const unsigned char *)data;
+			for (size_t i = 0; i < size; i++)
+			{
+				hash ^= bytes[i];
+				hash *= 1099511628211ull;
+			}
+			return hash;
 		}
+	}
 
-		int fileSize = 0;
-		fileFont.seekg(0, std::ios::end);
-		fileSize = (int)fileFont.tellg();
-		fileFont.seekg(0, std::ios::beg);
-		unsigned char *fileData = new unsigned char[fileSize];
-		fileFont.read((char *)fileData, fileSize);
-		fileFont.close();
+	///////////////////// Font bake cache /////////////////////
 
-		createFromTTF(fileData, fileSize);
+	static std::string fontCacheDirectory;
 
-		delete[] fileData;
+	void setFontCacheDirectory(const char *directory)
+	{
+		fontCacheDirectory = directory ? directory : "";
 	}
 
-	void Font::cleanup()
+	//file layout: header, packed chars, atlas pixels (one channel)
+	struct FontCacheHeader
 	{
-		texture.cleanup();
-		*this = {};
+		char     magic[8] = {'g', 'l', '2', 'd', 'f', 'o', 'n', 't'};
+		uint32_t version = 1;
+		uint32_t sdf = 0;
+		uint64_t key = 0;
+		int32_t  width = 0;
+		int32_t  height = 0;
+		int32_t  charCount = 0;
+		int32_t  bakeHeight = 0;
+		int32_t  padding = 0;
+		float    maxHeight = 0;
+	};
+
+	//the ttf and everything that changes the baked atlas
+	static uint64_t fontCacheKey(const unsigned char *ttf_data, const size_t ttf_data_size,
+		int sdf, int bakeHeight, int padding)
+	{
+		const int parameters[4] = {FontCacheHeader{}.version, sdf, bakeHeight, padding};
+		uint64_t key = internal::hashFNV1a(ttf_data, ttf_data_size);
+		return internal::hashFNV1a(parameters, sizeof(parameters), key);
 	}
 
+	static std::string fontCachePath(uint64_t key)
+	{
+		char name[32] = {};
+		snprintf(name, sizeof(name), "%016llx.gl2dfont", (unsigned long long)key);
+		return fontCacheDirectory + "/" + name;
+	}
 
-#pragma endregion
-
-	///////////////////// Camera /////////////////////
-#pragma region Camera
+	static void uploadFontAtlas(Font &font, const unsigned char *pixels)
+	{
+		glGenTextures(1, &font.texture.id);
+		glBindTexture(GL_TEXTURE_2D, font.texture.id);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, font.size.x, font.size.y, 0, GL_RED, GL_UNSIGNED_BYTE, pixels);
+		internal::registerTexture(font.texture.id, font.size, GL_R8, false);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-#pragma endregion
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-	///////////////////// Renderer2D /////////////////////
-#pragma region Renderer2D
+		if (font.sdf)
+		{
+			//so a custom shader that doesn't know about sdf still shows something
+			const GLint swizzle[4] = {GL_RED, GL_RED, GL_RED, GL_RED};
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+		else
+		{
+			//the shaders see a white glyph with the coverage as alpha
+			const GLint swizzle[4] = {GL_ONE, GL_ONE, GL_ONE, GL_RED};
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
+	}
 
-	//won't bind any fbo
-	void internalFlush(gl2d::Renderer2D &renderer, bool clearDrawData)
+	static void setSDFParameters(Font &font, int bakeHeight, int padding)
 	{
-		enableNecessaryGLFeatures();
+		font.sdf = true;
+		font.sdfBake = {bakeHeight, padding};
+		font.sdfPadding = padding * (65.f / bakeHeight);
+		font.sdfPaddingUV = {(float)padding / font.size.x, (float)padding / font.size.y};
+	}
 
-		if (!hasInitialized)
+	//maps the cache file and uploads the atlas straight from it
+	static bool loadFontCache(Font &font, uint64_t key)
+	{
+		if (fontCacheDirectory.empty())
 		{
-			errorFunc("Library not initialized. Have you forgotten to call gl2d::init() ?", userDefinedData);
+			return false;
 		}
 
-		if (!renderer.vao)
+		internal::MappedFile file;
+		if (!file.open(fontCachePath(key).c_str()) || file.size < sizeof(FontCacheHeader))
 		{
-			errorFunc("Renderer not initialized. Have you forgotten to call gl2d::Renderer2D::create() ?", userDefinedData);
+			return false;
 		}
 
-		if (renderer.windowH == 0 || renderer.windowW == 0)
-		{
-			if (clearDrawData)
-			{
-				renderer.clearDrawData();
-			}
+		FontCacheHeader header;
+		const FontCacheHeader expected;
+		memcpy(&header, file.data, sizeof(header));
 
-			return;
+		if (memcmp(header.magic, expected.magic, sizeof(header.magic)) || header.version != expected.version
+			|| header.key != key || header.width <= 0 || header.height <= 0 || header.charCount != ('~' - ' ')
+			|| file.size != sizeof(FontCacheHeader) + header.charCount * sizeof(stbtt_packedchar)
+			+ (size_t)header.width * header.height)
+		{
+			return false;
 		}
 
-		if (renderer.windowH < 0 || renderer.windowW < 0)
+		font.size = {header.width, header.height};
+		font.packedCharsBufferSize = header.charCount;
+		font.packedCharsBuffer = new stbtt_packedchar[header.charCount];
+		memcpy(font.packedCharsBuffer, file.data + sizeof(FontCacheHeader), header.charCount * sizeof(stbtt_packedchar));
+
+		if (header.sdf)
 		{
-			if (clearDrawData)
-			{
-				renderer.clearDrawData();
-			}
+			setSDFParameters(font, header.bakeHeight, header.padding);
+		}
 
-			errorFunc("Negative windowW or windowH, have you forgotten to call updateWindowMetrics(w, h)?", userDefinedData);
+		uploadFontAtlas(font, file.data + sizeof(FontCacheHeader) + header.charCount * sizeof(stbtt_packedchar));
 
-			return;
-		}
+		computeFontMetrics(font);
+		font.max_height = header.maxHeight;
 
-		if(renderer.spriteTextures.empty())
+		return true;
+	}
+
+	static void saveFontCache(const Font &font, uint64_t key, const unsigned char *pixels)
+	{
+		if (fontCacheDirectory.empty())
 		{
 			return;
 		}
 
-		glViewport(0, 0, renderer.windowW, renderer.windowH);
+		FontCacheHeader header;
+		header.sdf = font.sdf;
+		header.key = key;
+		header.width = font.size.x;
+		header.height = font.size.y;
+		header.charCount = font.packedCharsBufferSize;
+		header.bakeHeight = font.sdfBake.x;
+		header.padding = font.sdfBake.y;
+		header.maxHeight = font.max_height;
 
-		glBindVertexArray(renderer.vao);
+		//written under a temporary name so a crash never leaves a half written cache
+		const std::string path = fontCachePath(key);
+		const std::string temporaryPath = path + ".tmp";
 
-		glUseProgram(renderer.currentShader.id);
+		{
+			std::ofstream out(temporaryPath, std::ios::binary);
+			if (!out.is_open())
+			{
+				return;
+			}
 
-		glUniform1i(renderer.currentShader.u_sampler, 0);
+			out.write((const char *)&header, sizeof(header));
+			out.write((const char *)font.packedCharsBuffer, header.charCount * sizeof(stbtt_packedchar));
+			out.write((const char *)pixels, (size_t)header.width * header.height);
 
-		glBindBuffer(GL_ARRAY_BUFFER, renderer.buffers[Renderer2DBufferType::quadPositions]);
-		glBufferData(GL_ARRAY_BUFFER, renderer.spritePositions.size() * sizeof(glm::vec2), renderer.spritePositions.data(), GL_STREAM_DRAW);
+			if (!out.good())
+			{
+				out.close();
+				std::remove(temporaryPath.c_str());
+				return;
+			}
+		}
 
-		glBindBuffer(GL_ARRAY_BUFFER, renderer.buffers[Renderer2DBufferType::quadColors]);
-		glBufferData(GL_ARRAY_BUFFER, renderer.spriteColors.size() * sizeof(glm::vec4), renderer.spriteColors.data(), GL_STREAM_DRAW);
+		std::remove(path.c_str());
+		std::rename(temporaryPath.c_str(), path.c_str());
+	}
 
-		glBindBuffer(GL_ARRAY_BUFFER, renderer.buffers[Renderer2DBufferType::texturePositions]);
-		glBufferData(GL_ARRAY_BUFFER, renderer.texturePositions.size() * sizeof(glm::vec2), renderer.texturePositions.data(), GL_STREAM_DRAW);
+	void Font::createFromTTF(const unsigned char *ttf_data, const size_t ttf_data_size)
+	{
+		fontGeneration++;
 
-		//Instance render the textures
+		const uint64_t key = fontCacheKey(ttf_data, ttf_data_size, 0, 65, 0);
+		if (loadFontCache(*this, key))
 		{
-			const int size = renderer.spriteTextures.size();
-			int pos = 0;
-			unsigned int id = renderer.spriteTextures[0].id;
+			return;
+		}
 
-			renderer.spriteTextures[0].bind();
+		max_height = 0;
+		packedCharsBufferSize = ('~' - ' ');
+		packedCharsBuffer = new stbtt_packedchar[packedCharsBufferSize]{};
 
-			for (int i = 1; i < size; i++)
-			{
-				if (renderer.spriteTextures[i].id != id)
-				{
-					glDrawArrays(GL_TRIANGLES, pos * 6, 6 * (i - pos));
+		//STB TrueType gives us a one channel buffer, the atlas grows until all the glyphs fit
+		std::vector<unsigned char> fontMonochromeBuffer;
+		size = {256, 256};
 
-					pos = i;
-					id = renderer.spriteTextures[i].id;
+		for (;;)
+		{
+			fontMonochromeBuffer.assign(size.x * size.y, 0);
 
-					renderer.spriteTextures[i].bind();
-				}
+			stbtt_pack_context stbtt_context;
+			stbtt_PackBegin(&stbtt_context, fontMonochromeBuffer.data(), size.x, size.y, 0, 2, NULL);
+			stbtt_PackSetOversampling(&stbtt_context, 2, 2);
+			const int packed = stbtt_PackFontRange(&stbtt_context, ttf_data, 0, 65, ' ', '~' - ' ', packedCharsBuffer);
+			stbtt_PackEnd(&stbtt_context);
 
+			if (packed)
+			{
+				break;
 			}
 
-			glDrawArrays(GL_TRIANGLES, pos * 6, 6 * (size - pos));
+			if (size.y >= 8192)
+			{
+				errorFunc("Font glyphs don't fit in a 8192x8192 atlas", userDefinedData);
+				break;
+			}
 
-			glBindVertexArray(0);
+			if (size.x <= size.y) { size.x *= 2; }
+			else { size.y *= 2; }
 		}
 
-		if (clearDrawData) 
+		uploadFontAtlas(*this, fontMonochromeBuffer.data());
+
+		computeFontMetrics(*this);
+
+		saveFontCache(*this, key, fontMonochromeBuffer.data());
+	}
+
+	static bool mapFontFile(const char *file, internal::MappedFile &mapped)
+	{
+		if (!mapped.open(file))
 		{
-			renderer.clearDrawData();
+			char c[300] = {0};
+			strcat(c, "error openning: ");
+			strncat(c + strlen(c), file, 250);
+			errorFunc(c, userDefinedData);
+			return false;
 		}
+
+		return true;
 	}
 
-	void gl2d::Renderer2D::flush(bool clearDrawData)
+	void Font::createFromFile(const char *file)
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
-		internalFlush(*this, clearDrawData);
+		internal::MappedFile fileData;
+
+		if (mapFontFile(file, fileData))
+		{
+			createFromTTF(fileData.data, fileData.size);
+		}
 	}
 
-	void Renderer2D::flushFBO(FrameBuffer frameBuffer, bool clearDrawData)
+	namespace internal
 	{
-		if (frameBuffer.fbo == 0) 
+		//Packs the rects in rows (shelves) sorted by height.
+		//z and w are the sizes, x and y are the results. Returns false if they don't fit.
+		bool shelfPack(std::vector<glm::ivec4> &rects, const int w, const int h, const int spacing)
 		{
-			errorFunc("Framebuffer not initialized", userDefinedData);
-		}
+			std::vector<int> order(rects.size());
+			for (int i = 0; i < (int)order.size(); i++) { order[i] = i; }
 
-		glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer.fbo);
-		glBindTexture(GL_TEXTURE_2D, 0); //todo investigate and remove
+			std::sort(order.begin(), order.end(), [&](int a, int b) { return rects[a].w > rects[b].w; });
 
-		internalFlush(*this, clearDrawData);
+			int x = 0;
+			int y = 0;
+			int shelfHeight = 0;
 
-		glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
-	}
+			for (int i : order)
+			{
+				auto &r = rects[i];
 
-	void enableNecessaryGLFeatures()
-	{
-		glEnable(GL_BLEND);
-		glDisable(GL_DEPTH_TEST);
-		glBlendEquation(GL_FUNC_ADD);
-		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
-	}
+				if (r.z <= 0 || r.w <= 0)
+				{
+					r.x = 0;
+					r.y = 0;
+					continue;
+				}
 
-	///////////////////// Renderer2D - render ///////////////////// 
+				if (x + r.z > w)
+				{
+					x = 0;
+					y += shelfHeight + spacing;
+					shelfHeight = 0;
+				}
 
-	void Renderer2D::renderRectangle(const Rect transforms, const Texture texture, const Color4f colors[4], const glm::vec2 origin, const float rotation, const glm::vec4 textureCoords)
-	{
-		glm::vec2 newOrigin;
-		newOrigin.x = origin.x + transforms.x + (transforms.z / 2);
-		newOrigin.y = origin.y + transforms.y + (transforms.w / 2);
-		renderRectangleAbsRotation(transforms, texture, colors, newOrigin, rotation, textureCoords);
+				if (r.z > w || y + r.w > h)
+				{
+					return false;
+				}
+
+				r.x = x;
+				r.y = y;
+				x += r.z + spacing;
+				shelfHeight = std::max(shelfHeight, r.w);
+			}
+
+			return true;
+		}
 	}
 
-	void gl2d::Renderer2D::renderRectangleAbsRotation(const Rect transforms, 
-		const Texture texture, const Color4f colors[4], const glm::vec2 origin, const float rotation, const glm::vec4 textureCoords)
+	void Font::createSDFFromTTF(const unsigned char *ttf_data, const size_t ttf_data_size,
+		int bakeHeight, int padding)
 	{
-		Texture textureCopy = texture;
+		fontGeneration++;
 
-		if (textureCopy.id == 0)
+		bakeHeight = std::max(bakeHeight, 1);
+		padding = std::max(padding, 1);
+
+		const uint64_t key = fontCacheKey(ttf_data, ttf_data_size, 1, bakeHeight, padding);
+		if (loadFontCache(*this, key))
 		{
-			errorFunc("Invalid texture", userDefinedData);
-			textureCopy = white1pxSquareTexture;
+			sdfFonts[texture.id] = sdfStyle;
+			return;
 		}
 
-		//We need to flip texture_transforms.y
-		const float transformsY = transforms.y * -1;
-
-		glm::vec2 v1 = { transforms.x,				  transformsY };
-		glm::vec2 v2 = { transforms.x,				  transformsY - transforms.w };
-		glm::vec2 v3 = { transforms.x + transforms.z, transformsY - transforms.w };
-		glm::vec2 v4 = { transforms.x + transforms.z, transformsY };
-
-		//Apply rotations
-		if (rotation != 0)
+		stbtt_fontinfo info = {};
+		if (!stbtt_InitFont(&info, ttf_data, stbtt_GetFontOffsetForIndex(ttf_data, 0)))
 		{
-			v1 = rotateAroundPoint(v1, origin, rotation);
-			v2 = rotateAroundPoint(v2, origin, rotation);
-			v3 = rotateAroundPoint(v3, origin, rotation);
-			v4 = rotateAroundPoint(v4, origin, rotation);
+			errorFunc("Invalid ttf data", userDefinedData);
+			return;
 		}
 
-		//Apply camera transformations
-		v1.x -= currentCamera.position.x;
-		v1.y += currentCamera.position.y;
-		v2.x -= currentCamera.position.x;
-		v2.y += currentCamera.position.y;
-		v3.x -= currentCamera.position.x;
-		v3.y += currentCamera.position.y;
-		v4.x -= currentCamera.position.x;
-		v4.y += currentCamera.position.y;
+		const float scale = stbtt_ScaleForPixelHeight(&info, (float)bakeHeight);
+
+		//the layout uses the metrics of the 65px fonts baked by createFromTTF
+		const float metricsScale = 65.f / bakeHeight;
+
+		max_height = 0;
+		packedCharsBufferSize = ('~' - ' ');
+		packedCharsBuffer = new stbtt_packedchar[packedCharsBufferSize]{};
 
-		//Apply camera rotation
-		if (currentCamera.rotation != 0)
+		struct Glyph
 		{
-			glm::vec2 cameraCenter;
+			unsigned char *bitmap = 0;
+			int xoff = 0;
+			int yoff = 0;
+		};
 
-			cameraCenter.x = windowW / 2.0f;
-			cameraCenter.y = windowH / 2.0f;
+		std::vector<Glyph> glyphs(packedCharsBufferSize);
+		std::vector<glm::ivec4> rects(packedCharsBufferSize);
 
-			v1 = rotateAroundPoint(v1, cameraCenter, currentCamera.rotation);
-			v2 = rotateAroundPoint(v2, cameraCenter, currentCamera.rotation);
-			v3 = rotateAroundPoint(v3, cameraCenter, currentCamera.rotation);
-			v4 = rotateAroundPoint(v4, cameraCenter, currentCamera.rotation);
+		for (int i = 0; i < packedCharsBufferSize; i++)
+		{
+			int w = 0, h = 0;
+			glyphs[i].bitmap = stbtt_GetCodepointSDF(&info, scale, ' ' + i, padding, 128, 128.f / padding,
+				&w, &h, &glyphs[i].xoff, &glyphs[i].yoff);
+
+			rects[i] = {0, 0, glyphs[i].bitmap ? w : 0, glyphs[i].bitmap ? h : 0};
 		}
 
-		//Apply camera zoom
-		//if(renderer->currentCamera.zoom != 1)
+		//grow the atlas until everything fits
+		size = {64, 64};
+		while (!internal::shelfPack(rects, size.x, size.y, 1))
 		{
+			if (size.x <= size.y) { size.x *= 2; }
+			else { size.y *= 2; }
+		}
 
-			glm::vec2 cameraCenter;
-			cameraCenter.x = windowW / 2.0f;
-			cameraCenter.y = -windowH / 2.0f;
+		std::vector<unsigned char> pixels(size.x * size.y, 0);
 
-			v1 = scaleAroundPoint(v1, cameraCenter, currentCamera.zoom);
-			v2 = scaleAroundPoint(v2, cameraCenter, currentCamera.zoom);
-			v3 = scaleAroundPoint(v3, cameraCenter, currentCamera.zoom);
-			v4 = scaleAroundPoint(v4, cameraCenter, currentCamera.zoom);
-		}
+		for (int i = 0; i < packedCharsBufferSize; i++)
+		{
+			const auto &r = rects[i];
+			auto &packed = packedCharsBuffer[i];
 
-		v1.x = internal::positionToScreenCoordsX(v1.x, (float)windowW);
-		v2.x = internal::positionToScreenCoordsX(v2.x, (float)windowW);
-		v3.x = internal::positionToScreenCoordsX(v3.x, (float)windowW);
-		v4.x = internal::positionToScreenCoordsX(v4.x, (float)windowW);
-		v1.y = internal::positionToScreenCoordsY(v1.y, (float)windowH);
-		v2.y = internal::positionToScreenCoordsY(v2.y, (float)windowH);
-		v3.y = internal::positionToScreenCoordsY(v3.y, (float)windowH);
-		v4.y = internal::positionToScreenCoordsY(v4.y, (float)windowH);
+			int advance = 0;
+			stbtt_GetCodepointHMetrics(&info, ' ' + i, &advance, nullptr);
+			packed.xadvance = advance * scale * metricsScale;
 
-		spritePositions.push_back(glm::vec2{ v1.x, v1.y });
-		spritePositions.push_back(glm::vec2{ v2.x, v2.y });
-		spritePositions.push_back(glm::vec2{ v4.x, v4.y });
+			if (!glyphs[i].bitmap)
+			{
+				continue;
+			}
 
-		spritePositions.push_back(glm::vec2{ v2.x, v2.y });
-		spritePositions.push_back(glm::vec2{ v3.x, v3.y });
-		spritePositions.push_back(glm::vec2{ v4.x, v4.y });
+			for (int y = 0; y < r.w; y++)
+			{
+				memcpy(&pixels[(r.y + y) * size.x + r.x], &glyphs[i].bitmap[y * r.z], r.z);
+			}
 
-		spriteColors.push_back(colors[0]);
-		spriteColors.push_back(colors[1]);
-		spriteColors.push_back(colors[3]);
-		spriteColors.push_back(colors[1]);
-		spriteColors.push_back(colors[2]);
-		spriteColors.push_back(colors[3]);
+			stbtt_FreeSDF(glyphs[i].bitmap, nullptr);
+
+			//the glyph box without the padding
+			packed.x0 = r.x + padding;
+			packed.y0 = r.y + padding;
+			packed.x1 = r.x + r.z - padding;
+			packed.y1 = r.y + r.w - padding;
+			packed.xoff = (glyphs[i].xoff + padding) * metricsScale;
+			packed.yoff = (glyphs[i].yoff + padding) * metricsScale;
+			packed.xoff2 = packed.xoff + (r.z - padding * 2) * metricsScale;
+			packed.yoff2 = packed.yoff + (r.w - padding * 2) * metricsScale;
+		}
 
-		texturePositions.push_back(glm::vec2{ textureCoords.x, textureCoords.y }); //1
-		texturePositions.push_back(glm::vec2{ textureCoords.x, textureCoords.w }); //2
-		texturePositions.push_back(glm::vec2{ textureCoords.z, textureCoords.y }); //4
-		texturePositions.push_back(glm::vec2{ textureCoords.x, textureCoords.w }); //2
-		texturePositions.push_back(glm::vec2{ textureCoords.z, textureCoords.w }); //3
-		texturePositions.push_back(glm::vec2{ textureCoords.z, textureCoords.y }); //4
+		setSDFParameters(*this, bakeHeight, padding);
+		uploadFontAtlas(*this, pixels.data());
+		sdfFonts[texture.id] = sdfStyle;
 
-		spriteTextures.push_back(textureCopy);
-	}
+		computeFontMetrics(*this);
 
-	void Renderer2D::renderRectangle(const Rect transforms, const Color4f colors[4], const glm::vec2 origin, const float rotation)
-	{
-		renderRectangle(transforms, white1pxSquareTexture, colors, origin, rotation);
+		saveFontCache(*this, key, pixels.data());
 	}
 
-	void Renderer2D::renderRectangleAbsRotation(const Rect transforms, const Color4f colors[4], const glm::vec2 origin, const float rotation)
+	void Font::createSDFFromFile(const char *file, int bakeHeight, int padding)
 	{
-		renderRectangleAbsRotation(transforms, white1pxSquareTexture, colors, origin, rotation);
+		internal::MappedFile fileData;
+
+		if (mapFontFile(file, fileData))
+		{
+			createSDFFromTTF(fileData.data, fileData.size, bakeHeight, padding);
+		}
 	}
 
-	void Renderer2D::renderLine(const glm::vec2 position, const float angleDegrees, const float length, const Color4f color, const float width)
+	void Font::setSDFStyle(const SDFFontStyle &style)
 	{
-		renderRectangle({position - glm::vec2(0,width / 2.f), length, width},
-			color, {-length/2, 0}, angleDegrees);
+		sdfStyle = style;
+
+		if (sdf && texture.id)
+		{
+			sdfFonts[texture.id] = style;
+
+			if (glyphCache)
+			{
+				for (auto &p : glyphCache->pages)
+				{
+					sdfFonts[p.texture.id] = style;
+				}
+			}
+		}
 	}
 
-	void Renderer2D::renderLine(const glm::vec2 start, const glm::vec2 end, const Color4f color, const float width) 
+	void Font::createGlyphCache(const unsigned char *ttf_data, const size_t ttf_data_size,
+		size_t memoryBudget, int pageSize)
 	{
-		glm::vec2 vector = end - start;
-		float length = glm::length(vector);
-		float angle = std::atan2(vector.y, vector.x);
-		renderLine(start, -glm::degrees(angle), length, color, width);
+		if (glyphCache)
+		{
+			glyphCache->cleanup();
+			delete glyphCache;
+			glyphCache = nullptr;
+		}
+
+		auto cache = new GlyphCache();
+		cache->ttfData.assign(ttf_data, ttf_data + ttf_data_size);
+
+		if (!stbtt_InitFont(&cache->info, cache->ttfData.data(), stbtt_GetFontOffsetForIndex(cache->ttfData.data(), 0)))
+		{
+			errorFunc("Invalid ttf data", userDefinedData);
+			delete cache;
+			return;
+		}
+
+		//same metrics as the font atlas
+		if (sdf)
+		{
+			cache->scale = stbtt_ScaleForPixelHeight(&cache->info, (float)sdfBake.x);
+			cache->metricsScale = 65.f / sdfBake.x;
+			cache->sdfPadding = sdfBake.y;
+		}
+		else
+		{
+			cache->scale = stbtt_ScaleForPixelHeight(&cache->info, 65.f);
+			cache->metricsScale = 1.f;
+		}
+
+		cache->fontTexture = texture.id;
+		cache->memoryBudget = memoryBudget;
+		cache->pageSize = std::max(pageSize, 64);
+
+		glyphCache = cache;
 	}
 
-	void Renderer2D::renderRectangleOutline(const glm::vec4 position, const Color4f color, const float width,
-		const glm::vec2 origin, const float rotationDegrees)
+	void Font::createGlyphCacheFromFile(const char *file, size_t memoryBudget, int pageSize)
 	{
-		
-		glm::vec2 topLeft = position;
-		glm::vec2 topRight = glm::vec2(position) + glm::vec2(position.z, 0);
-		glm::vec2 bottomLeft = glm::vec2(position) + glm::vec2(0, position.w);
-		glm::vec2 bottomRight = glm::vec2(position) + glm::vec2(position.z, position.w);
-		
-		glm::vec2 p1 = topLeft + glm::vec2(-width / 2.f, 0);
-		glm::vec2 p2 = topRight + glm::vec2(+width / 2.f, 0);
-		glm::vec2 p3 = topRight + glm::vec2(0, +width / 2.f);
-		glm::vec2 p4 = bottomRight + glm::vec2(0, -width / 2.f);
-		glm::vec2 p5 = bottomRight + glm::vec2(width / 2.f, 0);
-		glm::vec2 p6 = bottomLeft + glm::vec2(-width / 2.f, 0);
-		glm::vec2 p7 = bottomLeft + glm::vec2(0, -width / 2.f);
-		glm::vec2 p8 = topLeft + glm::vec2(0, +width / 2.f);
+		internal::MappedFile fileData;
 
-		if (rotationDegrees != 0) 
+		if (mapFontFile(file, fileData))
 		{
-			glm::vec2 o = origin + glm::vec2(position.x, -position.y) + glm::vec2(position.z, -position.w) / 2.f;
+			createGlyphCache(fileData.data, fileData.size, memoryBudget, pageSize);
+		}
+	}
 
-			p1 = rotateAroundPoint(p1, o, -rotationDegrees);
-			p2 = rotateAroundPoint(p2, o, -rotationDegrees);
-			p3 = rotateAroundPoint(p3, o, -rotationDegrees);
-			p4 = rotateAroundPoint(p4, o, -rotationDegrees);
-			p5 = rotateAroundPoint(p5, o, -rotationDegrees);
-			p6 = rotateAroundPoint(p6, o, -rotationDegrees);
-			p7 = rotateAroundPoint(p7, o, -rotationDegrees);
-			p8 = rotateAroundPoint(p8, o, -rotationDegrees);
+	///////////////////// GlyphCache /////////////////////
+
+	const GlyphCache::Glyph *GlyphCache::getGlyph(uint32_t codepoint)
+	{
+		auto found = glyphs.find(codepoint);
+		if (found != glyphs.end())
+		{
+			touchPage(found->second.page);
+			return &found->second;
 		}
 
-		auto renderPoint = [&](glm::vec2 pos) 
+		if (!stbtt_FindGlyphIndex(&info, codepoint))
 		{
-			renderRectangle({pos - glm::vec2(1,1),2,2}, Colors_Black);
-		};
+			return nullptr;
+		}
 
-		renderPoint(p1);
-		renderPoint(p2);
-		renderPoint(p3);
-		renderPoint(p4);
-		renderPoint(p5);
-		renderPoint(p6);
-		renderPoint(p7);
-		renderPoint(p8);
+		Glyph glyph;
 
-		//add a padding so the lines align properly.
-		renderLine(p1, p2, color, width); //top line
-		renderLine(p3, p4, color, width);
-		renderLine(p5, p6, color, width); //bottom line
-		renderLine(p7, p8, color, width);
+		int w = 0, h = 0, xoff = 0, yoff = 0;
+		unsigned char *bitmap = nullptr;
 
-	}
+		if (sdfPadding)
+		{
+			bitmap = stbtt_GetCodepointSDF(&info, scale, codepoint, sdfPadding, 128, 128.f / sdfPadding,
+				&w, &h, &xoff, &yoff);
+		}
+		else
+		{
+			bitmap = stbtt_GetCodepointBitmap(&info, scale, scale, codepoint, &w, &h, &xoff, &yoff);
+		}
 
-	void  Renderer2D::renderCircleOutline(const glm::vec2 position, const Color4f color, const float size, const float width, const unsigned int segments)
-	{
-	
-		auto calcPos = [&](int p)
+		if (!bitmap || w <= 0 || h <= 0 || w > pageSize || h > pageSize)
 		{
-			glm::vec2 circle = {size,0};
+			//no pixels, only the advance is used
+			int advance = 0;
+			stbtt_GetCodepointHMetrics(&info, codepoint, &advance, nullptr);
+			glyph.quad = {0, 0, advance * scale * metricsScale, 0};
 
-			float a = 3.1415926 * 2 * ((float)p / segments);
+			if (bitmap) { stbtt_FreeBitmap(bitmap, nullptr); }
 
-			float c = std::cos(a);
-			float s = std::sin(a);
+			return &(glyphs[codepoint] = glyph);
+		}
 
-			circle = {c * circle.x - s * circle.y, s * circle.x + c * circle.y};
+		//find a page with room on its shelves
+		int page = -1;
+		glm::ivec2 pos = {};
 
-			return circle + position;
+		auto place = [&](Page &p) -> bool
+		{
+			if (p.shelfX + w > pageSize)
+			{
+				p.shelfX = 0;
+				p.shelfY += p.shelfHeight + 1;
+				p.shelfHeight = 0;
+			}
+
+			if (p.shelfY + h > pageSize)
+			{
+				return false;
+			}
+
+			pos = {p.shelfX, p.shelfY};
+			p.shelfX += w + 1;
+			p.shelfHeight = std::max(p.shelfHeight, h);
+			return true;
 		};
 
-		
-		glm::vec2 lastPos = calcPos(1);
-		renderLine(calcPos(0), lastPos, color, width);
-		for (int i = 1; i < segments; i++)
+		for (int i = 0; i < (int)pages.size(); i++)
 		{
+			if (pages[i].used && place(pages[i]))
+			{
+				page = i;
+				break;
+			}
+		}
 
-			glm::vec2 pos1 = lastPos;
-			glm::vec2 pos2 = calcPos(i + 1);
+		if (page < 0)
+		{
+			page = allocatePage();
+			place(pages[page]);
+		}
 
-			renderLine(pos1, pos2, color, width);
+		Page &p = pages[page];
+		p.codepoints.push_back(codepoint);
+		touchPage(page);
 
-			lastPos = pos2;
+		glBindTexture(GL_TEXTURE_2D, p.texture.id);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, pos.x, pos.y, w, h, GL_RED, GL_UNSIGNED_BYTE, bitmap);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		if (sdfPadding)
+		{
+			stbtt_FreeSDF(bitmap, nullptr);
+		}
+		else
+		{
+			stbtt_FreeBitmap(bitmap, nullptr);
 		}
 
+		//sdf glyph quads don't contain the padding, like the font atlas
+		const int pad = sdfPadding;
+		glyph.page = page;
+		glyph.quad = glm::vec4{xoff + pad, yoff + pad, xoff + w - pad, yoff + h - pad} * metricsScale;
+		glyph.uv = glm::vec4{pos.x + pad, pos.y + pad, pos.x + w - pad, pos.y + h - pad} / (float)pageSize;
+
+		return &(glyphs[codepoint] = glyph);
 	}
 
+	void GlyphCache::touchPage(int page)
+	{
+		if (page >= 0)
+		{
+			pages[page].lastUsedFlush = flushCounter;
+		}
+	}
 
+	size_t GlyphCache::getMemoryUsage()
+	{
+		size_t count = 0;
+		for (auto &p : pages)
+		{
+			if (p.used) { count++; }
+		}
+		return count * pageSize * pageSize;
+	}
 
-	void Renderer2D::render9Patch(const Rect position, const int borderSize, const Color4f color, const glm::vec2 origin, const float rotation, const Texture texture, const Texture_Coords textureCoords, const Texture_Coords inner_texture_coords)
+	int GlyphCache::allocatePage()
 	{
-		glm::vec4 colorData[4] = { color, color, color, color };
+		const size_t pageBytes = (size_t)pageSize * pageSize;
 
-		//inner
-		Rect innerPos = position;
-		innerPos.x += borderSize;
-		innerPos.y += borderSize;
-		innerPos.z -= borderSize * 2;
-		innerPos.w -= borderSize * 2;
-		renderRectangle(innerPos, texture, colorData, Position2D{ 0, 0 }, 0, inner_texture_coords);
+		//reuse the least recently used page that isn't in the current draw data
+		if (getMemoryUsage() + pageBytes > memoryBudget)
+		{
+			int oldest = -1;
+			for (int i = 0; i < (int)pages.size(); i++)
+			{
+				if (pages[i].used && pages[i].lastUsedFlush != flushCounter
+					&& (oldest < 0 || pages[i].lastUsedFlush < pages[oldest].lastUsedFlush))
+				{
+					oldest = i;
+				}
+			}
 
-		//top
-		Rect topPos = position;
-		topPos.x += borderSize;
-		topPos.z -= (float)borderSize * 2;
-		topPos.w = (float)borderSize;
-		glm::vec4 upperTexPos;
-		upperTexPos.x = inner_texture_coords.x;
-		upperTexPos.y = textureCoords.y;
-		upperTexPos.z = inner_texture_coords.z;
-		upperTexPos.w = inner_texture_coords.y;
-		renderRectangle(topPos, texture, colorData, Position2D{ 0, 0 }, 0, upperTexPos);
+			if (oldest >= 0)
+			{
+				evictPage(oldest);
+				pages[oldest].used = true;
+				return oldest;
+			}
+		}
 
-		//bottom
-		Rect bottom = position;
-		bottom.x += (float)borderSize;
-		bottom.y += (float)position.w - borderSize;
-		bottom.z -= (float)borderSize * 2;
-		bottom.w = (float)borderSize;
-		glm::vec4 bottomTexPos;
-		bottomTexPos.x = inner_texture_coords.x;
-		bottomTexPos.y = inner_texture_coords.w;
-		bottomTexPos.z = inner_texture_coords.z;
-		bottomTexPos.w = textureCoords.w;
-		renderRectangle(bottom, texture, colorData, Position2D{ 0, 0 }, 0, bottomTexPos);
+		for (int i = 0; i < (int)pages.size(); i++)
+		{
+			if (!pages[i].used)
+			{
+				pages[i].used = true;
+				return i;
+			}
+		}
 
-		//left
-		Rect left = position;
-		left.y += borderSize;
-		left.z = (float)borderSize;
-		left.w -= (float)borderSize * 2;
-		glm::vec4 leftTexPos;
-		leftTexPos.x = textureCoords.x;
-		leftTexPos.y = inner_texture_coords.y;
-		leftTexPos.z = inner_texture_coords.x;
-		leftTexPos.w = inner_texture_coords.w;
-		renderRectangle(left, texture, colorData, Position2D{ 0, 0 }, 0, leftTexPos);
+		Page p;
+		p.used = true;
 
-		//right
-		Rect right = position;
-		right.x += position.z - borderSize;
-		right.y += borderSize;
-		right.z = (float)borderSize;
-		right.w -= (float)borderSize * 2;
-		glm::vec4 rightTexPos;
-		rightTexPos.x = inner_texture_coords.z;
-		rightTexPos.y = inner_texture_coords.y;
-		rightTexPos.z = textureCoords.z;
-		rightTexPos.w = inner_texture_coords.w;
-		renderRectangle(right, texture, colorData, Position2D{ 0, 0 }, 0, rightTexPos);
+		glGenTextures(1, &p.texture.id);
+		glBindTexture(GL_TEXTURE_2D, p.texture.id);
 
-		//topleft
-		Rect topleft = position;
-		topleft.z = (float)borderSize;
-		topleft.w = (float)borderSize;
-		glm::vec4 topleftTexPos;
-		topleftTexPos.x = textureCoords.x;
-		topleftTexPos.y = textureCoords.y;
-		topleftTexPos.z = inner_texture_coords.x;
-		topleftTexPos.w = inner_texture_coords.y;
-		renderRectangle(topleft, texture, colorData, Position2D{ 0, 0 }, 0, topleftTexPos);
+		std::vector<unsigned char> zeros(pageBytes, 0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, pageSize, pageSize, 0, GL_RED, GL_UNSIGNED_BYTE, zeros.data());
+		internal::registerTexture(p.texture.id, {pageSize, pageSize}, GL_R8, false);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 
-		//topright
-		Rect topright = position;
-		topright.x += position.z - borderSize;
-		topright.z = (float)borderSize;
-		topright.w = (float)borderSize;
-		glm::vec4 toprightTexPos;
-		toprightTexPos.x = inner_texture_coords.z;
-		toprightTexPos.y = textureCoords.y;
-		toprightTexPos.z = textureCoords.z;
-		toprightTexPos.w = inner_texture_coords.y;
-		renderRectangle(topright, texture, colorData, Position2D{ 0, 0 }, 0, toprightTexPos);
+		//same swizzle as the font atlas
+		if (sdfPadding)
+		{
+			const GLint swizzle[4] = {GL_RED, GL_RED, GL_RED, GL_RED};
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
 
-		//bottomleft
-		Rect bottomleft = position;
-		bottomleft.y += position.w - borderSize;
-		bottomleft.z = (float)borderSize;
-		bottomleft.w = (float)borderSize;
-		glm::vec4 bottomleftTexPos;
-		bottomleftTexPos.x = textureCoords.x;
-		bottomleftTexPos.y = inner_texture_coords.w;
-		bottomleftTexPos.z = inner_texture_coords.x;
-		bottomleftTexPos.w = textureCoords.w;
-		renderRectangle(bottomleft, texture, colorData, Position2D{ 0, 0 }, 0, bottomleftTexPos);
+			auto style = sdfFonts.find(fontTexture);
+			sdfFonts[p.texture.id] = style != sdfFonts.end() ? style->second : SDFFontStyle{};
+		}
+		else
+		{
+			const GLint swizzle[4] = {GL_ONE, GL_ONE, GL_ONE, GL_RED};
+			glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+		}
 
-		//bottomright
-		Rect bottomright = position;
-		bottomright.y += position.w - borderSize;
-		bottomright.x += position.z - borderSize;
-		bottomright.z = (float)borderSize;
-		bottomright.w = (float)borderSize;
-		glm::vec4 bottomrightTexPos;
-		bottomrightTexPos.x = inner_texture_coords.z;
-		bottomrightTexPos.y = inner_texture_coords.w;
-		bottomrightTexPos.z = textureCoords.z;
-		bottomrightTexPos.w = textureCoords.w;
-		renderRectangle(bottomright, texture, colorData, Position2D{ 0, 0 }, 0, bottomrightTexPos);
+		pages.push_back(std::move(p));
+		return (int)pages.size() - 1;
+	}
 
+	void GlyphCache::evictPage(int page)
+	{
+		Page &p = pages[page];
+
+		for (auto c : p.codepoints)
+		{
+			glyphs.erase(c);
+		}
+
+		p.codepoints.clear();
+		p.shelfX = 0;
+		p.shelfY = 0;
+		p.shelfHeight = 0;
+		p.used = false;
+
+		//the new glyphs are filtered with their neighbours so the old pixels have to go
+		std::vector<unsigned char> zeros((size_t)pageSize * pageSize, 0);
+		glBindTexture(GL_TEXTURE_2D, p.texture.id);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, pageSize, pageSize, GL_RED, GL_UNSIGNED_BYTE, zeros.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+		//the cached text layouts point into this page
+		fontGeneration++;
 	}
 
-	void Renderer2D::render9Patch2(const Rect position, const Color4f color, const glm::vec2 origin, const float rotation, const Texture texture, const Texture_Coords textureCoords, const Texture_Coords inner_texture_coords)
+	void GlyphCache::cleanup()
 	{
-		glm::vec4 colorData[4] = { color, color, color, color };
+		for (auto &p : pages)
+		{
+			sdfFonts.erase(p.texture.id);
+			p.texture.cleanup();
+		}
 
-		int w = 0;
-		int h = 0;
-		glBindTexture(GL_TEXTURE_2D, texture.id);
-		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
-		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+		pages.clear();
+		glyphs.clear();
+		ttfData.clear();
+		fontGeneration++;
+	}
 
-		float textureSpaceW = textureCoords.z - textureCoords.x;
-		float textureSpaceH = textureCoords.y - textureCoords.w;
+	void Font::cleanup()
+	{
+		fontGeneration++;
+		sdfFonts.erase(texture.id);
+		delete[] advanceTable;
 
-		float topBorder = (textureCoords.y - inner_texture_coords.y) / textureSpaceH * position.w;
-		float bottomBorder = (inner_texture_coords.w - textureCoords.w) / textureSpaceH * position.w;
-		float leftBorder = (inner_texture_coords.x - textureCoords.x) / textureSpaceW * position.z;
-		float rightBorder = (textureCoords.z - inner_texture_coords.z) / textureSpaceW * position.z;
+		if (glyphCache)
+		{
+			glyphCache->cleanup();
+			delete glyphCache;
+		}
 
-		float newAspectRatio = position.z / position.w;
-		
-		if (newAspectRatio < 1.f) 
+		texture.cleanup();
+		*this = {};
+	}
+
+
+#pragma endregion
+
+	///////////////////// Camera /////////////////////
+#pragma region Camera
+
+#pragma endregion
+
+	///////////////////// Renderer2D /////////////////////
+#pragma region Renderer2D
+
+	//Binds the texture of a run. Sdf fonts switch to the sdf version of the default shaders,
+	//custom shaders are left alone.
+	static void bindTextureRun(Texture texture, const ShaderProgram &flushShader, GLuint &boundProgram,
+		float depthStep)
+	{
+		const ShaderProgram *program = &flushShader;
+		const SDFFontStyle *style = nullptr;
+		const SDFShader *sdf = nullptr;
+
+		if (!sdfFonts.empty() && (flushShader.id == defaultShader.id || flushShader.id == multiViewShader.id))
 		{
-			topBorder *= newAspectRatio;
-			bottomBorder *= newAspectRatio;
+			auto found = sdfFonts.find(texture.id);
+			if (found != sdfFonts.end())
+			{
+				style = &found->second;
+				sdf = &sdfShaders[flushShader.id == multiViewShader.id];
+				program = &sdf->program;
+			}
 		}
-		else
+
+		if (program->id != boundProgram)
 		{
-			leftBorder /= newAspectRatio;
-			rightBorder /= newAspectRatio;
+			glUseProgram(program->id);
+			boundProgram = program->id;
+
+			glUniform1i(program->u_sampler, 0);
+			if (program->u_depthStep >= 0)
+			{
+				glUniform1f(program->u_depthStep, depthStep);
+			}
 		}
 
-	
+		if (style)
+		{
+			glUniform4fv(sdf->u_outlineColor, 1, &style->outlineColor[0]);
+			glUniform1f(sdf->u_outlineWidth, style->outlineWidth);
+			glUniform4fv(sdf->u_shadowColor, 1, &style->shadowColor[0]);
+			glUniform2fv(sdf->u_shadowOffset, 1, &style->shadowOffset[0]);
+			glUniform1f(sdf->u_shadowSoftness, style->shadowSoftness);
+		}
 
-		//topBorder = 50;
-		//bottomBorder = -50;
-		//leftBorder = 0;
-		//rightBorder = 0;
+		internal::touchTexture(texture.id);
+		texture.bind();
+	}
 
+	//opaque triangles are drawn front to back with depth writes, then the rest back to front with blending
+	static void drawEarlyZ(gl2d::Renderer2D &renderer, const ShaderProgram &shader, GLuint &boundProgram,
+		float depthStep)
+	{
+		//batches with the same texture and opacity
+		struct Batch
+		{
+			int first;
+			int count;
+			Texture texture;
+			unsigned char opaque;
+		};
 
-		//inner
-		Rect innerPos = position;
-		innerPos.x += leftBorder;
-		innerPos.y += topBorder;
-		innerPos.z -= leftBorder + rightBorder;
-		innerPos.w -= topBorder + bottomBorder;
-		renderRectangle(innerPos, texture, colorData, Position2D{ 0, 0 }, 0, inner_texture_coords);
+		static std::vector<Batch> batches;
+		batches.clear();
 
-		//top
-		Rect topPos = position;
-		topPos.x += leftBorder;
-		topPos.z -= leftBorder + rightBorder;
-		topPos.w = topBorder;
-		glm::vec4 upperTexPos;
-		upperTexPos.x = inner_texture_coords.x;
-		upperTexPos.y = textureCoords.y;
-		upperTexPos.z = inner_texture_coords.z;
-		upperTexPos.w = inner_texture_coords.y;
-		renderRectangle(topPos, texture, colorData, Position2D{ 0, 0 }, 0, upperTexPos);
+		const int size = renderer.spriteTextures.size();
+		int pos = 0;
+		for (int i = 1; i <= size; i++)
+		{
+			if (i == size || renderer.spriteTextures[i].id != renderer.spriteTextures[pos].id
+				|| renderer.spriteOpaque[i] != renderer.spriteOpaque[pos])
+			{
+				batches.push_back({pos * 3, (i - pos) * 3, renderer.spriteTextures[pos], renderer.spriteOpaque[pos]});
+				pos = i;
+			}
+		}
 
-		//Rect topPos = position;
-		//topPos.x += leftBorder;
-		//topPos.w = topBorder;
-		//topPos.z = topBorder;
-		//float end = rightBorder;
-		//float size = topBorder;
-		//
-		//while(1)
-		//{
-		//	if(topPos.x + size <= end)
-		//	{
-		//
-		//		//draw
-		//		renderRectangle(topPos, colorData, Position2D{ 0, 0 }, 0, texture, upperTexPos);
-		//
-		//		topPos += size;
-		//	}else
-		//	{
-		//		float newW = end - topPos.x;
-		//		if(newW>0)
-		//		{
-		//			topPos.z = newW;
-		//			renderRectangle(topPos, colorData, Position2D{ 0, 0 }, 0, texture, upperTexPos);
-		//		}
-		//		break;
-		//	}
-		//
-		//}
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+		glClear(GL_DEPTH_BUFFER_BIT);
 
+		glDisable(GL_BLEND);
+		for (int i = (int)batches.size() - 1; i >= 0; i--)
+		{
+			if (batches[i].opaque)
+			{
+				//the clip rect needs the discard, sdf fonts need their own shader
+				const bool noDiscard = batches[i].opaque == 2 && shader.id == defaultShader.id
+					&& sdfFonts.find(batches[i].texture.id) == sdfFonts.end();
 
-		//bottom
-		Rect bottom = position;
-		bottom.x += leftBorder;
-		bottom.y += (float)position.w - bottomBorder;
-		bottom.z -= leftBorder + rightBorder;
-		bottom.w = bottomBorder;
-		glm::vec4 bottomTexPos;
-		bottomTexPos.x = inner_texture_coords.x;
-		bottomTexPos.y = inner_texture_coords.w;
-		bottomTexPos.z = inner_texture_coords.z;
-		bottomTexPos.w = textureCoords.w;
-		renderRectangle(bottom, texture, colorData, Position2D{ 0, 0 }, 0, bottomTexPos);
+				bindTextureRun(batches[i].texture, noDiscard ? opaqueShader : shader, boundProgram, depthStep);
+				glDrawArrays(GL_TRIANGLES, batches[i].first, batches[i].count);
+			}
+		}
 
-		//left
-		Rect left = position;
-		left.y += topBorder;
-		left.z = leftBorder;
-		left.w -= topBorder + bottomBorder;
-		glm::vec4 leftTexPos;
-		leftTexPos.x = textureCoords.x;
-		leftTexPos.y = inner_texture_coords.y;
-		leftTexPos.z = inner_texture_coords.x;
-		leftTexPos.w = inner_texture_coords.w;
-		renderRectangle(left, texture, colorData, Position2D{ 0, 0 }, 0, leftTexPos);
+		glEnable(GL_BLEND);
+		glDepthMask(GL_FALSE);
+		for (int i = 0; i < (int)batches.size(); i++)
+		{
+			if (!batches[i].opaque)
+			{
+				bindTextureRun(batches[i].texture, shader, boundProgram, depthStep);
+				glDrawArrays(GL_TRIANGLES, batches[i].first, batches[i].count);
+			}
+		}
 
-		//right
-		Rect right = position;
-		right.x += position.z - rightBorder;
-		right.y += topBorder;
-		right.z = rightBorder;
-		right.w -= topBorder + bottomBorder;
-		glm::vec4 rightTexPos;
-		rightTexPos.x = inner_texture_coords.z;
-		rightTexPos.y = inner_texture_coords.y;
-		rightTexPos.z = textureCoords.z;
-		rightTexPos.w = inner_texture_coords.w;
-		renderRectangle(right, texture, colorData, Position2D{ 0, 0 }, 0, rightTexPos);
+		glDepthMask(GL_TRUE);
+		glDisable(GL_DEPTH_TEST);
+	}
 
-		//topleft
+	//reads the last finished overdraw query without waiting for the gpu and starts a new one
+	//area is the viewport of this flush, the window or the fbo
+	static void beginOverdrawQuery(gl2d::Renderer2D &renderer, float area)
+	{
+		if (!renderer.overdrawQueries[0])
+		{
+			glGenQueries(2, renderer.overdrawQueries);
+		}
+
+		const int index = renderer.overdrawQueryIndex;
+		const GLuint query = renderer.overdrawQueries[index];
+
+		if (renderer.overdrawQueryIssued[index])
+		{
+			GLuint available = 0;
+			glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+
+			if (available)
+			{
+				GLuint samples = 0;
+				glGetQueryObjectuiv(query, GL_QUERY_RESULT, &samples);
+				renderer.lastOverdraw = (float)samples / renderer.overdrawQueryArea[index];
+			}
+		}
+
+		glBeginQuery(GL_SAMPLES_PASSED, query);
+		renderer.overdrawQueryIssued[index] = true;
+		renderer.overdrawQueryArea[index] = area;
+	}
+
+	static void endOverdrawQuery(gl2d::Renderer2D &renderer)
+	{
+		glEndQuery(GL_SAMPLES_PASSED);
+		renderer.overdrawQueryIndex = (renderer.overdrawQueryIndex + 1) % 2;
+	}
+
+	//won't bind any fbo
+	//if viewCount is not 0 the multi view shader is used and every batch is drawn once per view
+	//hasDepth tells if the bound framebuffer has a depth buffer (needed for the early z pass)
+	//viewport is the size of the drawn area, 0 means the window size
+	void internalFlush(gl2d::Renderer2D &renderer, bool clearDrawData, int viewCount = 0, bool hasDepth = true,
+		glm::ivec2 viewport = {})
+	{
+		enableNecessaryGLFeatures();
+
+		if (!hasInitialized)
+		{
+			errorFunc("Library not initialized. Have you forgotten to call gl2d::init() ?", userDefinedData);
+		}
+
+		if (!renderer.vao)
+		{
+			errorFunc("Renderer not initialized. Have you forgotten to call gl2d::Renderer2D::create() ?", userDefinedData);
+		}
+
+		if (renderer.windowH == 0 || renderer.windowW == 0)
+		{
+			if (clearDrawData)
+			{
+				renderer.clearDrawData();
+			}
+
+			return;
+		}
+
+		if (renderer.windowH < 0 || renderer.windowW < 0)
+		{
+			if (clearDrawData)
+			{
+				renderer.clearDrawData();
+			}
+
+			errorFunc("Negative windowW or windowH, have you forgotten to call updateWindowMetrics(w, h)?", userDefinedData);
+
+			return;
+		}
+
+		if(renderer.spriteTextures.empty())
+		{
+			return;
+		}
+
+		if (viewport.x <= 0 || viewport.y <= 0)
+		{
+			viewport = {renderer.windowW, renderer.windowH};
+		}
+
+		glViewport(0, 0, viewport.x, viewport.y);
+
+		glBindVertexArray(renderer.vao);
+
+		const ShaderProgram &shader = viewCount ? multiViewShader : renderer.currentShader;
+
+		glUseProgram(shader.id);
+		GLuint boundProgram = shader.id;
+
+		glUniform1i(shader.u_sampler, 0);
+
+		const bool earlyZ = renderer.earlyZ && hasDepth && !viewCount && shader.u_depthStep >= 0;
+		const float depthStep = earlyZ ? 1.f / (renderer.spriteTextures.size() + 2) : 0.f;
+
+		if (shader.u_depthStep >= 0)
+		{
+			glUniform1f(shader.u_depthStep, depthStep);
+		}
+
+		if (renderer.reportOverdraw)
+		{
+			beginOverdrawQuery(renderer, (float)viewport.x * viewport.y);
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, renderer.buffers[Renderer2DBufferType::quadPositions]);
+		glBufferData(GL_ARRAY_BUFFER, renderer.spritePositions.size() * sizeof(glm::vec2), renderer.spritePositions.data(), GL_STREAM_DRAW);
+
+		glBindBuffer(GL_ARRAY_BUFFER, renderer.buffers[Renderer2DBufferType::quadColors]);
+		glBufferData(GL_ARRAY_BUFFER, renderer.spriteColors.size() * sizeof(glm::vec4), renderer.spriteColors.data(), GL_STREAM_DRAW);
+
+		glBindBuffer(GL_ARRAY_BUFFER, renderer.buffers[Renderer2DBufferType::texturePositions]);
+		glBufferData(GL_ARRAY_BUFFER, renderer.texturePositions.size() * sizeof(glm::vec2), renderer.texturePositions.data(), GL_STREAM_DRAW);
+
+		glBindBuffer(GL_ARRAY_BUFFER, renderer.buffers[Renderer2DBufferType::clipRects]);
+		glBufferData(GL_ARRAY_BUFFER, renderer.spriteClipRects.size() * sizeof(glm::vec4), renderer.spriteClipRects.data(), GL_STREAM_DRAW);
+
+		auto drawTriangles = [viewCount](int first, int count)
+		{
+			if (viewCount)
+			{
+				glDrawArraysInstanced(GL_TRIANGLES, first, count, viewCount);
+			}
+			else
+			{
+				glDrawArrays(GL_TRIANGLES, first, count);
+			}
+		};
+
+		if (earlyZ)
+		{
+			drawEarlyZ(renderer, shader, boundProgram, depthStep);
+		}
+		else //Instance render the textures
+		{
+			const int size = renderer.spriteTextures.size();
+			int pos = 0;
+			unsigned int id = renderer.spriteTextures[0].id;
+
+			bindTextureRun(renderer.spriteTextures[0], shader, boundProgram, depthStep);
+
+			for (int i = 1; i < size; i++)
+			{
+				if (renderer.spriteTextures[i].id != id)
+				{
+					drawTriangles(pos * 3, 3 * (i - pos));
+
+					pos = i;
+					id = renderer.spriteTextures[i].id;
+
+					bindTextureRun(renderer.spriteTextures[i], shader, boundProgram, depthStep);
+				}
+
+			}
+
+			drawTriangles(pos * 3, 3 * (size - pos));
+		}
+
+		glBindVertexArray(0);
+
+		if (renderer.reportOverdraw)
+		{
+			endOverdrawQuery(renderer);
+		}
+
+		internal::evictTextures();
+		flushCounter++;
+
+		if (clearDrawData) 
+		{
+			renderer.clearDrawData();
+		}
+	}
+
+	void gl2d::Renderer2D::flush(bool clearDrawData)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
+		internalFlush(*this, clearDrawData);
+	}
+
+	void Renderer2D::flushMultiView(const RenderView *views, const int viewCount, bool clearDrawData)
+	{
+		if (viewCount <= 0 || viewCount > GL2D_MAX_VIEWS)
+		{
+			errorFunc("flushMultiView view count must be between 1 and GL2D_MAX_VIEWS", userDefinedData);
+
+			if (clearDrawData)
+			{
+				this->clearDrawData();
+			}
+
+			return;
+		}
+
+		//same layout as the gl2d_Views uniform block (std140)
+		struct
+		{
+			glm::vec4 camera[GL2D_MAX_VIEWS];
+			glm::vec4 viewport[GL2D_MAX_VIEWS];
+			glm::vec4 target;
+		}viewData = {};
+
+		for (int i = 0; i < viewCount; i++)
+		{
+			const Camera &c = views[i].camera;
+			viewData.camera[i] = {c.position.x, c.position.y, glm::radians(c.rotation), c.zoom};
+			viewData.viewport[i] = views[i].viewport;
+		}
+		viewData.target = {windowW, windowH, 0, 0};
+
+		if (!viewsBuffer)
+		{
+			glGenBuffers(1, &viewsBuffer);
+		}
+
+		glBindBuffer(GL_UNIFORM_BUFFER, viewsBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(viewData), &viewData, GL_STREAM_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, GL2D_VIEWS_UNIFORM_BINDING, viewsBuffer);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
+		internalFlush(*this, clearDrawData, viewCount);
+	}
+
+	void Renderer2D::flushFBO(FrameBuffer frameBuffer, bool clearDrawData)
+	{
+		if (frameBuffer.fbo == 0) 
+		{
+			errorFunc("Framebuffer not initialized", userDefinedData);
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer.fbo);
+		glBindTexture(GL_TEXTURE_2D, 0); //todo investigate and remove
+
+		internalFlush(*this, clearDrawData, 0, frameBuffer.depthBuffer != 0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
+	}
+
+	void Renderer2D::flushFBO(FrameBuffer frameBuffer, glm::ivec2 viewportSize, bool clearDrawData)
+	{
+		if (frameBuffer.fbo == 0)
+		{
+			errorFunc("Framebuffer not initialized", userDefinedData);
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer.fbo);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		internalFlush(*this, clearDrawData, 0, frameBuffer.depthBuffer != 0, viewportSize);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
+	}
+
+	///////////////////// DynamicResolution /////////////////////
+
+	void DynamicResolution::create(float targetFrameMs, float minScale, float maxScale)
+	{
+		cleanup();
+
+		this->targetFrameMs = targetFrameMs;
+		this->minScale = minScale;
+		this->maxScale = maxScale;
+		scale = maxScale;
+
+		glGenQueries(GL2D_DYNAMIC_RESOLUTION_QUERIES, queries);
+		fb.create(1, 1);
+		fbSize = {1, 1};
+	}
+
+	void DynamicResolution::cleanup()
+	{
+		if (queries[0])
+		{
+			glDeleteQueries(GL2D_DYNAMIC_RESOLUTION_QUERIES, queries);
+		}
+
+		fb.cleanup();
+
+		for (int i = 0; i < GL2D_DYNAMIC_RESOLUTION_QUERIES; i++)
+		{
+			queries[i] = 0;
+			queryIssued[i] = false;
+		}
+		queryIndex = 0;
+		framesSinceChange = 0;
+		fbSize = {};
+	}
+
+	void DynamicResolution::updateScale()
+	{
+		//the oldest query is the one that is reused now, it had the most time to finish
+		const int index = queryIndex;
+
+		if (queryIssued[index])
+		{
+			GLuint available = 0;
+			glGetQueryObjectuiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+
+			if (available)
+			{
+				GLuint64 nanoseconds = 0;
+				glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &nanoseconds);
+				lastGpuMs = nanoseconds / 1'000'000.f;
+			}
+		}
+
+		framesSinceChange++;
+
+		if (framesSinceChange < cooldownFrames || lastGpuMs <= 0)
+		{
+			return;
+		}
+
+		float newScale = scale;
+
+		if (lastGpuMs > targetFrameMs * (1.f + hysteresis))
+		{
+			newScale -= scaleStep;
+		}
+		else if (lastGpuMs < targetFrameMs * (1.f - hysteresis))
+		{
+			newScale += scaleStep;
+		}
+
+		newScale = std::min(std::max(newScale, minScale), maxScale);
+
+		if (newScale != scale)
+		{
+			scale = newScale;
+			framesSinceChange = 0;
+		}
+	}
+
+	void DynamicResolution::flush(Renderer2D &renderer)
+	{
+		if (!fb.fbo)
+		{
+			errorFunc("DynamicResolution not initialized. Have you forgotten to call create() ?", userDefinedData);
+			renderer.clearDrawData();
+			return;
+		}
+
+		if (renderer.windowW <= 0 || renderer.windowH <= 0)
+		{
+			renderer.clearDrawData();
+			return;
+		}
+
+		updateScale();
+
+		glm::ivec2 size = {std::max(1, (int)(renderer.windowW * scale)), std::max(1, (int)(renderer.windowH * scale))};
+
+		if (size != fbSize)
+		{
+			fb.resize(size.x, size.y);
+			fbSize = size;
+		}
+
+		glBeginQuery(GL_TIME_ELAPSED, queries[queryIndex]);
+		queryIssued[queryIndex] = true;
+
+		//the coordinates are still in window pixels, only the viewport is scaled
+		glBindFramebuffer(GL_FRAMEBUFFER, fb.fbo);
+		glClear(GL_COLOR_BUFFER_BIT);
+		renderer.flushFBO(fb, size);
+
+		//upscale
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, fb.fbo);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, renderer.defaultFBO);
+		glBlitFramebuffer(0, 0, size.x, size.y, 0, 0, renderer.windowW, renderer.windowH,
+			GL_COLOR_BUFFER_BIT, GL_LINEAR);
+		glBindFramebuffer(GL_FRAMEBUFFER, renderer.defaultFBO);
+
+		glEndQuery(GL_TIME_ELAPSED);
+		queryIndex = (queryIndex + 1) % GL2D_DYNAMIC_RESOLUTION_QUERIES;
+	}
+
+	void enableNecessaryGLFeatures()
+	{
+		glEnable(GL_BLEND);
+		glDisable(GL_DEPTH_TEST);
+		glBlendEquation(GL_FUNC_ADD);
+		glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+	}
+
+	///////////////////// Renderer2D - transforms ///////////////////// 
+
+	namespace internal
+	{
+		//Rotates the 4 vertices around point (which is flipped like in rotateAroundPoint).
+		//The sine and cosine are computed once for the whole quad.
+		static inline void rotateQuadAroundPoint(glm::vec2 v[4], glm::vec2 point, const float degrees)
+		{
+			point.y = -point.y;
+			const float a = glm::radians(degrees);
+			const float s = sinf(a);
+			const float c = cosf(a);
+
+			for (int i = 0; i < 4; i++)
+			{
+				const float x = v[i].x - point.x;
+				const float y = v[i].y - point.y;
+				v[i].x = x * c - y * s + point.x;
+				v[i].y = x * s + y * c + point.y;
+			}
+		}
+
+		//Applies the camera to points that are already in flipped y pixel coordinates
+		//and converts them to screen coords.
+		template<bool CameraRotated, bool Zoomed>
+		void transformPoints(glm::vec2 *v, const int count,
+			const Camera &camera, const float windowW, const float windowH)
+		{
+			//Apply camera transformations
+			for (int i = 0; i < count; i++)
+			{
+				v[i].x -= camera.position.x;
+				v[i].y += camera.position.y;
+			}
+
+			if constexpr (CameraRotated)
+			{
+				glm::vec2 point = {windowW / 2.0f, -windowH / 2.0f};
+				const float a = glm::radians(camera.rotation);
+				const float s = sinf(a);
+				const float c = cosf(a);
+
+				for (int i = 0; i < count; i++)
+				{
+					const float x = v[i].x - point.x;
+					const float y = v[i].y - point.y;
+					v[i].x = x * c - y * s + point.x;
+					v[i].y = x * s + y * c + point.y;
+				}
+			}
+
+			if constexpr (Zoomed)
+			{
+				const glm::vec2 cameraCenter = {windowW / 2.0f, -windowH / 2.0f};
+
+				for (int i = 0; i < count; i++)
+				{
+					v[i] = scaleAroundPoint(v[i], cameraCenter, camera.zoom);
+				}
+			}
+
+			for (int i = 0; i < count; i++)
+			{
+				v[i].x = positionToScreenCoordsX(v[i].x, windowW);
+				v[i].y = positionToScreenCoordsY(v[i].y, windowH);
+			}
+		}
+
+		//One instantiation per combination of sprite rotation, camera rotation and camera zoom.
+		//The branches are resolved at compile time so the common case
+		//(axis aligned sprite, no camera rotation, zoom 1) only translates and converts to screen coords.
+		template<bool Rotated, bool CameraRotated, bool Zoomed>
+		void transformQuad(glm::vec2 v[4], const glm::vec2 origin, const float rotation,
+			const Camera &camera, const float windowW, const float windowH)
+		{
+			if constexpr (Rotated)
+			{
+				rotateQuadAroundPoint(v, origin, rotation);
+			}
+
+			transformPoints<CameraRotated, Zoomed>(v, 4, camera, windowW, windowH);
+		}
+
+		//indexed by [cameraRotated][zoomed][rotated]
+		static const QuadTransformFunc quadTransformTable[2][2][2] =
+		{
+			{
+				{ transformQuad<false, false, false>, transformQuad<true, false, false> },
+				{ transformQuad<false, false, true>,  transformQuad<true, false, true> },
+			},
+			{
+				{ transformQuad<false, true, false>,  transformQuad<true, true, false> },
+				{ transformQuad<false, true, true>,   transformQuad<true, true, true> },
+			},
+		};
+
+		//indexed by [cameraRotated][zoomed]
+		static const PointTransformFunc pointTransformTable[2][2] =
+		{
+			{ transformPoints<false, false>, transformPoints<false, true> },
+			{ transformPoints<true, false>,  transformPoints<true, true> },
+		};
+	}
+
+	void Renderer2D::updateTransformPipeline()
+	{
+		pipelineCameraRotation = currentCamera.rotation;
+		pipelineCameraZoom = currentCamera.zoom;
+
+		const bool cameraRotated = currentCamera.rotation != 0;
+		const bool zoomed = currentCamera.zoom != 1;
+
+		quadTransforms[0] = internal::quadTransformTable[cameraRotated][zoomed][0];
+		quadTransforms[1] = internal::quadTransformTable[cameraRotated][zoomed][1];
+		pointTransform = internal::pointTransformTable[cameraRotated][zoomed];
+	}
+
+	///////////////////// Renderer2D - render ///////////////////// 
+
+	void Renderer2D::renderRectangle(const Rect transforms, const Texture texture, const Color4f colors[4], const glm::vec2 origin, const float rotation, const glm::vec4 textureCoords)
+	{
+		glm::vec2 newOrigin;
+		newOrigin.x = origin.x + transforms.x + (transforms.z / 2);
+		newOrigin.y = origin.y + transforms.y + (transforms.w / 2);
+		renderRectangleAbsRotation(transforms, texture, colors, newOrigin, rotation, textureCoords);
+	}
+
+	void gl2d::Renderer2D::renderRectangleAbsRotation(const Rect transforms, 
+		const Texture texture, const Color4f colors[4], const glm::vec2 origin, const float rotation, const glm::vec4 textureCoords)
+	{
+		Texture textureCopy = texture;
+
+		if (textureCopy.id == 0)
+		{
+			errorFunc("Invalid texture", userDefinedData);
+			textureCopy = white1pxSquareTexture;
+		}
+
+		//We need to flip texture_transforms.y
+		const float transformsY = transforms.y * -1;
+
+		glm::vec2 v[4] =
+		{
+			{ transforms.x,				  transformsY },
+			{ transforms.x,				  transformsY - transforms.w },
+			{ transforms.x + transforms.z, transformsY - transforms.w },
+			{ transforms.x + transforms.z, transformsY },
+		};
+
+		if (currentCamera.rotation != pipelineCameraRotation || currentCamera.zoom != pipelineCameraZoom
+			|| !quadTransforms[0])
+		{
+			updateTransformPipeline();
+		}
+
+		quadTransforms[rotation != 0](v, origin, rotation, currentCamera, (float)windowW, (float)windowH);
+
+		const glm::vec2 &v1 = v[0];
+		const glm::vec2 &v2 = v[1];
+		const glm::vec2 &v3 = v[2];
+		const glm::vec2 &v4 = v[3];
+
+		spritePositions.push_back(glm::vec2{ v1.x, v1.y });
+		spritePositions.push_back(glm::vec2{ v2.x, v2.y });
+		spritePositions.push_back(glm::vec2{ v4.x, v4.y });
+
+		spritePositions.push_back(glm::vec2{ v2.x, v2.y });
+		spritePositions.push_back(glm::vec2{ v3.x, v3.y });
+		spritePositions.push_back(glm::vec2{ v4.x, v4.y });
+
+		spriteColors.push_back(colors[0]);
+		spriteColors.push_back(colors[1]);
+		spriteColors.push_back(colors[3]);
+		spriteColors.push_back(colors[1]);
+		spriteColors.push_back(colors[2]);
+		spriteColors.push_back(colors[3]);
+
+		texturePositions.push_back(glm::vec2{ textureCoords.x, textureCoords.y }); //1
+		texturePositions.push_back(glm::vec2{ textureCoords.x, textureCoords.w }); //2
+		texturePositions.push_back(glm::vec2{ textureCoords.z, textureCoords.y }); //4
+		texturePositions.push_back(glm::vec2{ textureCoords.x, textureCoords.w }); //2
+		texturePositions.push_back(glm::vec2{ textureCoords.z, textureCoords.w }); //3
+		texturePositions.push_back(glm::vec2{ textureCoords.z, textureCoords.y }); //4
+
+		spriteClipRects.insert(spriteClipRects.end(), 6, currentClipRect);
+
+		spriteTextures.push_back(textureCopy);
+		spriteTextures.push_back(textureCopy);
+		spriteOpaque.push_back(opaqueFlag());
+		spriteOpaque.push_back(opaqueFlag());
+	}
+
+	void Renderer2D::renderRectangle(const Rect transforms, const Color4f colors[4], const glm::vec2 origin, const float rotation)
+	{
+		renderRectangle(transforms, white1pxSquareTexture, colors, origin, rotation);
+	}
+
+	void Renderer2D::renderRectangleAbsRotation(const Rect transforms, const Color4f colors[4], const glm::vec2 origin, const float rotation)
+	{
+		renderRectangleAbsRotation(transforms, white1pxSquareTexture, colors, origin, rotation);
+	}
+
+	void Renderer2D::renderTriangle(const glm::vec2 points[3], const Texture texture,
+		const Color4f colors[3], const glm::vec2 textureCoords[3])
+	{
+		const unsigned int indices[3] = {0, 1, 2};
+		renderMesh(points, colors, textureCoords, 3, indices, 3, texture);
+	}
+
+	void Renderer2D::renderTriangle(const glm::vec2 p1, const glm::vec2 p2, const glm::vec2 p3, const Color4f color)
+	{
+		const glm::vec2 points[3] = {p1, p2, p3};
+		const Color4f colors[3] = {color, color, color};
+		renderTriangle(points, white1pxSquareTexture, colors, nullptr);
+	}
+
+	void Renderer2D::renderConvexPolygon(const glm::vec2 *points, const int count, const Texture texture,
+		const Color4f *colors, const glm::vec2 *textureCoords)
+	{
+		if (count < 3)
+		{
+			return;
+		}
+
+		if (count > GL2D_MAX_POLYGON_POINTS)
+		{
+			errorFunc("Too many points in renderConvexPolygon", userDefinedData);
+			return;
+		}
+
+		//triangle fan around the first point
+		unsigned int indices[(GL2D_MAX_POLYGON_POINTS - 2) * 3];
+		int indexCount = 0;
+		for (int i = 1; i < count - 1; i++)
+		{
+			indices[indexCount++] = 0;
+			indices[indexCount++] = i;
+			indices[indexCount++] = i + 1;
+		}
+
+		renderMesh(points, colors, textureCoords, count, indices, indexCount, texture);
+	}
+
+	void Renderer2D::renderConvexPolygon(const glm::vec2 *points, const int count, const Color4f color)
+	{
+		if (count > GL2D_MAX_POLYGON_POINTS)
+		{
+			errorFunc("Too many points in renderConvexPolygon", userDefinedData);
+			return;
+		}
+
+		Color4f colors[GL2D_MAX_POLYGON_POINTS];
+		for (int i = 0; i < count; i++) { colors[i] = color; }
+
+		renderConvexPolygon(points, count, white1pxSquareTexture, colors, nullptr);
+	}
+
+	void Renderer2D::renderMesh(const glm::vec2 *positions, const Color4f *colors, const glm::vec2 *textureCoords,
+		const int vertexCount, const unsigned int *indices, const int indexCount, const Texture texture)
+	{
+		Texture textureCopy = texture;
+
+		if (textureCopy.id == 0)
+		{
+			textureCopy = white1pxSquareTexture;
+		}
+
+		if (indexCount % 3 != 0)
+		{
+			errorFunc("renderMesh index count is not a multiple of 3", userDefinedData);
+			return;
+		}
+
+		if (currentCamera.rotation != pipelineCameraRotation || currentCamera.zoom != pipelineCameraZoom
+			|| !pointTransform)
+		{
+			updateTransformPipeline();
+		}
+
+		//transform every vertex once, the indices only copy the results
+		meshTransformedPositions.resize(vertexCount);
+		for (int i = 0; i < vertexCount; i++)
+		{
+			//We need to flip y
+			meshTransformedPositions[i] = {positions[i].x, -positions[i].y};
+		}
+		pointTransform(meshTransformedPositions.data(), vertexCount, currentCamera, (float)windowW, (float)windowH);
+
+		const unsigned char opaque = opaqueFlag();
+
+		for (int i = 0; i < indexCount; i++)
+		{
+			const unsigned int index = indices[i];
+
+			if (index >= (unsigned int)vertexCount)
+			{
+				errorFunc("renderMesh index out of range", userDefinedData);
+				spritePositions.resize(spritePositions.size() - (i % 3));
+				spriteColors.resize(spriteColors.size() - (i % 3));
+				texturePositions.resize(texturePositions.size() - (i % 3));
+				spriteClipRects.resize(spriteClipRects.size() - (i % 3));
+				return;
+			}
+
+			spritePositions.push_back(meshTransformedPositions[index]);
+			spriteColors.push_back(colors ? colors[index] : Colors_White);
+			texturePositions.push_back(textureCoords ? textureCoords[index] : glm::vec2{0.5f, 0.5f});
+			spriteClipRects.push_back(currentClipRect);
+
+			if (i % 3 == 2)
+			{
+				spriteTextures.push_back(textureCopy);
+				spriteOpaque.push_back(opaque);
+			}
+		}
+	}
+
+	void Renderer2D::renderLine(const glm::vec2 position, const float angleDegrees, const float length, const Color4f color, const float width)
+	{
+		renderRectangle({position - glm::vec2(0,width / 2.f), length, width},
+			color, {-length/2, 0}, angleDegrees);
+	}
+
+	void Renderer2D::renderLine(const glm::vec2 start, const glm::vec2 end, const Color4f color, const float width) 
+	{
+		glm::vec2 vector = end - start;
+		float length = glm::length(vector);
+		float angle = std::atan2(vector.y, vector.x);
+		renderLine(start, -glm::degrees(angle), length, color, width);
+	}
+
+	void Renderer2D::renderRectangleOutline(const glm::vec4 position, const Color4f color, const float width,
+		const glm::vec2 origin, const float rotationDegrees)
+	{
+		
+		glm::vec2 topLeft = position;
+		glm::vec2 topRight = glm::vec2(position) + glm::vec2(position.z, 0);
+		glm::vec2 bottomLeft = glm::vec2(position) + glm::vec2(0, position.w);
+		glm::vec2 bottomRight = glm::vec2(position) + glm::vec2(position.z, position.w);
+		
+		glm::vec2 p1 = topLeft + glm::vec2(-width / 2.f, 0);
+		glm::vec2 p2 = topRight + glm::vec2(+width / 2.f, 0);
+		glm::vec2 p3 = topRight + glm::vec2(0, +width / 2.f);
+		glm::vec2 p4 = bottomRight + glm::vec2(0, -width / 2.f);
+		glm::vec2 p5 = bottomRight + glm::vec2(width / 2.f, 0);
+		glm::vec2 p6 = bottomLeft + glm::vec2(-width / 2.f, 0);
+		glm::vec2 p7 = bottomLeft + glm::vec2(0, -width / 2.f);
+		glm::vec2 p8 = topLeft + glm::vec2(0, +width / 2.f);
+
+		if (rotationDegrees != 0) 
+		{
+			glm::vec2 o = origin + glm::vec2(position.x, -position.y) + glm::vec2(position.z, -position.w) / 2.f;
+
+			p1 = rotateAroundPoint(p1, o, -rotationDegrees);
+			p2 = rotateAroundPoint(p2, o, -rotationDegrees);
+			p3 = rotateAroundPoint(p3, o, -rotationDegrees);
+			p4 = rotateAroundPoint(p4, o, -rotationDegrees);
+			p5 = rotateAroundPoint(p5, o, -rotationDegrees);
+			p6 = rotateAroundPoint(p6, o, -rotationDegrees);
+			p7 = rotateAroundPoint(p7, o, -rotationDegrees);
+			p8 = rotateAroundPoint(p8, o, -rotationDegrees);
+		}
+
+		auto renderPoint = [&](glm::vec2 pos) 
+		{
+			renderRectangle({pos - glm::vec2(1,1),2,2}, Colors_Black);
+		};
+
+		renderPoint(p1);
+		renderPoint(p2);
+		renderPoint(p3);
+		renderPoint(p4);
+		renderPoint(p5);
+		renderPoint(p6);
+		renderPoint(p7);
+		renderPoint(p8);
+
+		//add a padding so the lines align properly.
+		renderLine(p1, p2, color, width); //top line
+		renderLine(p3, p4, color, width);
+		renderLine(p5, p6, color, width); //bottom line
+		renderLine(p7, p8, color, width);
+
+	}
+
+	void  Renderer2D::renderCircleOutline(const glm::vec2 position, const Color4f color, const float size, const float width, const unsigned int segments)
+	{
+	
+		auto calcPos = [&](int p)
+		{
+			glm::vec2 circle = {size,0};
+
+			float a = 3.1415926 * 2 * ((float)p / segments);
+
+			float c = std::cos(a);
+			float s = std::sin(a);
+
+			circle = {c * circle.x - s * circle.y, s * circle.x + c * circle.y};
+
+			return circle + position;
+		};
+
+		
+		glm::vec2 lastPos = calcPos(1);
+		renderLine(calcPos(0), lastPos, color, width);
+		for (int i = 1; i < segments; i++)
+		{
+
+			glm::vec2 pos1 = lastPos;
+			glm::vec2 pos2 = calcPos(i + 1);
+
+			renderLine(pos1, pos2, color, width);
+
+			lastPos = pos2;
+		}
+
+	}
+
+
+
+	void Renderer2D::render9Patch(const Rect position, const int borderSize, const Color4f color, const glm::vec2 origin, const float rotation, const Texture texture, const Texture_Coords textureCoords, const Texture_Coords inner_texture_coords)
+	{
+		glm::vec4 colorData[4] = { color, color, color, color };
+
+		//inner
+		Rect innerPos = position;
+		innerPos.x += borderSize;
+		innerPos.y += borderSize;
+		innerPos.z -= borderSize * 2;
+		innerPos.w -= borderSize * 2;
+		renderRectangle(innerPos, texture, colorData, Position2D{ 0, 0 }, 0, inner_texture_coords);
+
+		//top
+		Rect topPos = position;
+		topPos.x += borderSize;
+		topPos.z -= (float)borderSize * 2;
+		topPos.w = (float)borderSize;
+		glm::vec4 upperTexPos;
+		upperTexPos.x = inner_texture_coords.x;
+		upperTexPos.y = textureCoords.y;
+		upperTexPos.z = inner_texture_coords.z;
+		upperTexPos.w = inner_texture_coords.y;
+		renderRectangle(topPos, texture, colorData, Position2D{ 0, 0 }, 0, upperTexPos);
+
+		//bottom
+		Rect bottom = position;
+		bottom.x += (float)borderSize;
+		bottom.y += (float)position.w - borderSize;
+		bottom.z -= (float)borderSize * 2;
+		bottom.w = (float)borderSize;
+		glm::vec4 bottomTexPos;
+		bottomTexPos.x = inner_texture_coords.x;
+		bottomTexPos.y = inner_texture_coords.w;
+		bottomTexPos.z = inner_texture_coords.z;
+		bottomTexPos.w = textureCoords.w;
+		renderRectangle(bottom, texture, colorData, Position2D{ 0, 0 }, 0, bottomTexPos);
+
+		//left
+		Rect left = position;
+		left.y += borderSize;
+		left.z = (float)borderSize;
+		left.w -= (float)borderSize * 2;
+		glm::vec4 leftTexPos;
+		leftTexPos.x = textureCoords.x;
+		leftTexPos.y = inner_texture_coords.y;
+		leftTexPos.z = inner_texture_coords.x;
+		leftTexPos.w = inner_texture_coords.w;
+		renderRectangle(left, texture, colorData, Position2D{ 0, 0 }, 0, leftTexPos);
+
+		//right
+		Rect right = position;
+		right.x += position.z - borderSize;
+		right.y += borderSize;
+		right.z = (float)borderSize;
+		right.w -= (float)borderSize * 2;
+		glm::vec4 rightTexPos;
+		rightTexPos.x = inner_texture_coords.z;
+		rightTexPos.y = inner_texture_coords.y;
+		rightTexPos.z = textureCoords.z;
+		rightTexPos.w = inner_texture_coords.w;
+		renderRectangle(right, texture, colorData, Position2D{ 0, 0 }, 0, rightTexPos);
+
+		//topleft
+		Rect topleft = position;
+		topleft.z = (float)borderSize;
+		topleft.w = (float)borderSize;
+		glm::vec4 topleftTexPos;
+		topleftTexPos.x = textureCoords.x;
+		topleftTexPos.y = textureCoords.y;
+		topleftTexPos.z = inner_texture_coords.x;
+		topleftTexPos.w = inner_texture_coords.y;
+		renderRectangle(topleft, texture, colorData, Position2D{ 0, 0 }, 0, topleftTexPos);
+
+		//topright
+		Rect topright = position;
+		topright.x += position.z - borderSize;
+		topright.z = (float)borderSize;
+		topright.w = (float)borderSize;
+		glm::vec4 toprightTexPos;
+		toprightTexPos.x = inner_texture_coords.z;
+		toprightTexPos.y = textureCoords.y;
+		toprightTexPos.z = textureCoords.z;
+		toprightTexPos.w = inner_texture_coords.y;
+		renderRectangle(topright, texture, colorData, Position2D{ 0, 0 }, 0, toprightTexPos);
+
+		//bottomleft
+		Rect bottomleft = position;
+		bottomleft.y += position.w - borderSize;
+		bottomleft.z = (float)borderSize;
+		bottomleft.w = (float)borderSize;
+		glm::vec4 bottomleftTexPos;
+		bottomleftTexPos.x = textureCoords.x;
+		bottomleftTexPos.y = inner_texture_coords.w;
+		bottomleftTexPos.z = inner_texture_coords.x;
+		bottomleftTexPos.w = textureCoords.w;
+		renderRectangle(bottomleft, texture, colorData, Position2D{ 0, 0 }, 0, bottomleftTexPos);
+
+		//bottomright
+		Rect bottomright = position;
+		bottomright.y += position.w - borderSize;
+		bottomright.x += position.z - borderSize;
+		bottomright.z = (float)borderSize;
+		bottomright.w = (float)borderSize;
+		glm::vec4 bottomrightTexPos;
+		bottomrightTexPos.x = inner_texture_coords.z;
+		bottomrightTexPos.y = inner_texture_coords.w;
+		bottomrightTexPos.z = textureCoords.z;
+		bottomrightTexPos.w = textureCoords.w;
+		renderRectangle(bottomright, texture, colorData, Position2D{ 0, 0 }, 0, bottomrightTexPos);
+
+	}
+
+	void Renderer2D::render9Patch2(const Rect position, const Color4f color, const glm::vec2 origin, const float rotation, const Texture texture, const Texture_Coords textureCoords, const Texture_Coords inner_texture_coords)
+	{
+		glm::vec4 colorData[4] = { color, color, color, color };
+
+		//from the registry, an evicted texture still reports its real size
+		Texture sizeQuery = texture;
+		const glm::ivec2 textureSize = sizeQuery.GetSize();
+		int w = textureSize.x;
+		int h = textureSize.y;
+
+		float textureSpaceW = textureCoords.z - textureCoords.x;
+		float textureSpaceH = textureCoords.y - textureCoords.w;
+
+		float topBorder = (textureCoords.y - inner_texture_coords.y) / textureSpaceH * position.w;
+		float bottomBorder = (inner_texture_coords.w - textureCoords.w) / textureSpaceH * position.w;
+		float leftBorder = (inner_texture_coords.x - textureCoords.x) / textureSpaceW * position.z;
+		float rightBorder = (textureCoords.z - inner_texture_coords.z) / textureSpaceW * position.z;
+
+		float newAspectRatio = position.z / position.w;
+		
+		if (newAspectRatio < 1.f) 
+		{
+			topBorder *= newAspectRatio;
+			bottomBorder *= newAspectRatio;
+		}
+		else
+		{
+			leftBorder /= newAspectRatio;
+			rightBorder /= newAspectRatio;
+		}
+
+	
+
+		//topBorder = 50;
+		//bottomBorder = -50;
+		//leftBorder = 0;
+		//rightBorder = 0;
+
+
+		//inner
+		Rect innerPos = position;
+		innerPos.x += leftBorder;
+		innerPos.y += topBorder;
+		innerPos.z -= leftBorder + rightBorder;
+		innerPos.w -= topBorder + bottomBorder;
+		renderRectangle(innerPos, texture, colorData, Position2D{ 0, 0 }, 0, inner_texture_coords);
+
+		//top
+		Rect topPos = position;
+		topPos.x += leftBorder;
+		topPos.z -= leftBorder + rightBorder;
+		topPos.w = topBorder;
+		glm::vec4 upperTexPos;
+		upperTexPos.x = inner_texture_coords.x;
+		upperTexPos.y = textureCoords.y;
+		upperTexPos.z = inner_texture_coords.z;
+		upperTexPos.w = inner_texture_coords.y;
+		renderRectangle(topPos, texture, colorData, Position2D{ 0, 0 }, 0, upperTexPos);
+
+		//Rect topPos = position;
+		//topPos.x += leftBorder;
+		//topPos.w = topBorder;
+		//topPos.z = topBorder;
+		//float end = rightBorder;
+		//float size = topBorder;
+		//
+		//while(1)
+		//{
+		//	if(topPos.x + size <= end)
+		//	{
+		//
+		//		//draw
+		//		renderRectangle(topPos, colorData, Position2D{ 0, 0 }, 0, texture, upperTexPos);
+		//
+		//		topPos += size;
+		//	}else
+		//	{
+		//		float newW = end - topPos.x;
+		//		if(newW>0)
+		//		{
+		//			topPos.z = newW;
+		//			renderRectangle(topPos, colorData, Position2D{ 0, 0 }, 0, texture, upperTexPos);
+		//		}
+		//		break;
+		//	}
+		//
+		//}
+
+
+		//bottom
+		Rect bottom = position;
+		bottom.x += leftBorder;
+		bottom.y += (float)position.w - bottomBorder;
+		bottom.z -= leftBorder + rightBorder;
+		bottom.w = bottomBorder;
+		glm::vec4 bottomTexPos;
+		bottomTexPos.x = inner_texture_coords.x;
+		bottomTexPos.y = inner_texture_coords.w;
+		bottomTexPos.z = inner_texture_coords.z;
+		bottomTexPos.w = textureCoords.w;
+		renderRectangle(bottom, texture, colorData, Position2D{ 0, 0 }, 0, bottomTexPos);
+
+		//left
+		Rect left = position;
+		left.y += topBorder;
+		left.z = leftBorder;
+		left.w -= topBorder + bottomBorder;
+		glm::vec4 leftTexPos;
+		leftTexPos.x = textureCoords.x;
+		leftTexPos.y = inner_texture_coords.y;
+		leftTexPos.z = inner_texture_coords.x;
+		leftTexPos.w = inner_texture_coords.w;
+		renderRectangle(left, texture, colorData, Position2D{ 0, 0 }, 0, leftTexPos);
+
+		//right
+		Rect right = position;
+		right.x += position.z - rightBorder;
+		right.y += topBorder;
+		right.z = rightBorder;
+		right.w -= topBorder + bottomBorder;
+		glm::vec4 rightTexPos;
+		rightTexPos.x = inner_texture_coords.z;
+		rightTexPos.y = inner_texture_coords.y;
+		rightTexPos.z = textureCoords.z;
+		rightTexPos.w = inner_texture_coords.w;
+		renderRectangle(right, texture, colorData, Position2D{ 0, 0 }, 0, rightTexPos);
+
+		//topleft
 		Rect topleft = position;
 		topleft.z = leftBorder;
 		topleft.w = topBorder;
@@ -1093,1146 +2661,2744 @@ namespace gl2d
 		//repair here?
 
 
-		//topright
-		Rect topright = position;
-		topright.x += position.z - rightBorder;
-		topright.z = rightBorder;
-		topright.w = topBorder;
-		glm::vec4 toprightTexPos;
-		toprightTexPos.x = inner_texture_coords.z;
-		toprightTexPos.y = textureCoords.y;
-		toprightTexPos.z = textureCoords.z;
-		toprightTexPos.w = inner_texture_coords.y;
-		renderRectangle(topright, texture, colorData, Position2D{ 0, 0 }, 0, toprightTexPos);
+		//topright
+		Rect topright = position;
+		topright.x += position.z - rightBorder;
+		topright.z = rightBorder;
+		topright.w = topBorder;
+		glm::vec4 toprightTexPos;
+		toprightTexPos.x = inner_texture_coords.z;
+		toprightTexPos.y = textureCoords.y;
+		toprightTexPos.z = textureCoords.z;
+		toprightTexPos.w = inner_texture_coords.y;
+		renderRectangle(topright, texture, colorData, Position2D{ 0, 0 }, 0, toprightTexPos);
+
+		//bottomleft
+		Rect bottomleft = position;
+		bottomleft.y += position.w - bottomBorder;
+		bottomleft.z = leftBorder;
+		bottomleft.w = bottomBorder;
+		glm::vec4 bottomleftTexPos;
+		bottomleftTexPos.x = textureCoords.x;
+		bottomleftTexPos.y = inner_texture_coords.w;
+		bottomleftTexPos.z = inner_texture_coords.x;
+		bottomleftTexPos.w = textureCoords.w;
+		renderRectangle(bottomleft, texture, colorData, Position2D{ 0, 0 }, 0, bottomleftTexPos);
+
+		//bottomright
+		Rect bottomright = position;
+		bottomright.y += position.w - bottomBorder;
+		bottomright.x += position.z - rightBorder;
+		bottomright.z = rightBorder;
+		bottomright.w = bottomBorder;
+		glm::vec4 bottomrightTexPos;
+		bottomrightTexPos.x = inner_texture_coords.z;
+		bottomrightTexPos.y = inner_texture_coords.w;
+		bottomrightTexPos.z = textureCoords.z;
+		bottomrightTexPos.w = textureCoords.w;
+		renderRectangle(bottomright, texture, colorData, Position2D{ 0, 0 }, 0, bottomrightTexPos);
+
+	}
+
+	void Renderer2D::create(GLuint fbo, size_t quadCount)
+	{
+		if (!hasInitialized)
+		{
+			errorFunc("Library not initialized. Have you forgotten to call gl2d::init() ?", userDefinedData);
+		}
+
+		defaultFBO = fbo;
+
+		clearDrawData();
+		spritePositions.reserve(quadCount * 6);
+		spriteColors.reserve(quadCount * 6);
+		texturePositions.reserve(quadCount * 6);
+		spriteClipRects.reserve(quadCount * 6);
+		spriteTextures.reserve(quadCount * 2);
+		spriteOpaque.reserve(quadCount * 2);
+
+		this->resetCameraAndShader();
+
+		glGenVertexArrays(1, &vao);
+		glBindVertexArray(vao);
+
+		glGenBuffers(Renderer2DBufferType::bufferSize, buffers);
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[Renderer2DBufferType::quadPositions]);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[Renderer2DBufferType::quadColors]);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[Renderer2DBufferType::texturePositions]);
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+		glBindBuffer(GL_ARRAY_BUFFER, buffers[Renderer2DBufferType::clipRects]);
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+
+		glBindVertexArray(0);
+	}
+
+	void Renderer2D::cleanup()
+	{
+		glDeleteVertexArrays(1, &vao);
+		glDeleteBuffers(Renderer2DBufferType::bufferSize, buffers);
+
+		if (viewsBuffer)
+		{
+			glDeleteBuffers(1, &viewsBuffer);
+			viewsBuffer = 0;
+		}
+
+		if (overdrawQueries[0])
+		{
+			glDeleteQueries(2, overdrawQueries);
+			overdrawQueries[0] = 0;
+			overdrawQueries[1] = 0;
+		}
+
+		renderTargets.cleanup();
+	}
+
+	void Renderer2D::pushShader(ShaderProgram s)
+	{
+		shaderPushPop.push_back(currentShader);
+		currentShader = s;
+	}
+
+	void Renderer2D::popShader()
+	{
+		if (shaderPushPop.empty())
+		{
+			errorFunc("Pop on an empty stack on popShader", userDefinedData);
+		}
+		else
+		{
+			currentShader = shaderPushPop.back();
+			shaderPushPop.pop_back();
+		}
+	}
+
+	void Renderer2D::pushCamera(Camera c)
+	{
+		cameraPushPop.push_back(currentCamera);
+		currentCamera = c;
+		updateTransformPipeline();
+	}
+
+	void Renderer2D::popCamera()
+	{
+		if (cameraPushPop.empty())
+		{
+			errorFunc("Pop on an empty stack on popCamera", userDefinedData);
+		}
+		else
+		{
+			currentCamera = cameraPushPop.back();
+			cameraPushPop.pop_back();
+			updateTransformPipeline();
+		}
+	}
+
+	void Renderer2D::pushClipRect(const Rect clip)
+	{
+		clipRectPushPop.push_back(currentClipRect);
+
+		//window pixels (top left origin) to screen coords (min, max)
+		glm::vec4 rect;
+		rect.x = internal::positionToScreenCoordsX(clip.x, (float)windowW);
+		rect.z = internal::positionToScreenCoordsX(clip.x + clip.z, (float)windowW);
+		rect.y = internal::positionToScreenCoordsY(-(clip.y + clip.w), (float)windowH);
+		rect.w = internal::positionToScreenCoordsY(-clip.y, (float)windowH);
+
+		//intersect with the current clip rect
+		currentClipRect.x = std::max(currentClipRect.x, rect.x);
+		currentClipRect.y = std::max(currentClipRect.y, rect.y);
+		currentClipRect.z = std::min(currentClipRect.z, rect.z);
+		currentClipRect.w = std::min(currentClipRect.w, rect.w);
+	}
+
+	void Renderer2D::popClipRect()
+	{
+		if (clipRectPushPop.empty())
+		{
+			errorFunc("Pop on an empty stack on popClipRect", userDefinedData);
+		}
+		else
+		{
+			currentClipRect = clipRectPushPop.back();
+			clipRectPushPop.pop_back();
+		}
+	}
+
+	glm::vec4 Renderer2D::getViewRect()
+	{
+		auto rect = glm::vec4{0, 0, windowW, windowH};
+
+		glm::mat3 mat = 
+		{1.f, 0, currentCamera.position.x ,
+		 0, 1.f, currentCamera.position.y,
+		 0, 0, 1.f};
+		mat = glm::transpose(mat);
+
+		glm::vec3 pos1 = {rect.x, rect.y, 1.f};
+		glm::vec3 pos2 = {rect.z + rect.x, rect.w + rect.y, 1.f};
+
+		pos1 = mat * pos1;
+		pos2 = mat * pos2;
+		
+		glm::vec2 point((pos1.x + pos2.x) / 2.f, (pos1.y + pos2.y) / 2.f);
+
+		pos1 = glm::vec3(scaleAroundPoint(pos1, point, 1.f/currentCamera.zoom), 1.f);
+		pos2 = glm::vec3(scaleAroundPoint(pos2, point, 1.f/currentCamera.zoom), 1.f);
+
+		rect = {pos1.x, pos1.y, pos2.x - pos1.x, pos2.y - pos1.y};
+
+		return rect;
+	}
+
+	glm::vec4 Renderer2D::toScreen(const glm::vec4& transform)
+	{
+		//We need to flip texture_transforms.y
+		const float transformsY = transform.y * -1;
+
+		glm::vec2 v1 = { transform.x,				  transformsY };
+		glm::vec2 v2 = { transform.x,				  transformsY - transform.w };
+		glm::vec2 v3 = { transform.x + transform.z, transformsY - transform.w };
+		glm::vec2 v4 = { transform.x + transform.z, transformsY };
+
+		//Apply camera transformations
+		v1.x -= currentCamera.position.x;
+		v1.y += currentCamera.position.y;
+		v2.x -= currentCamera.position.x;
+		v2.y += currentCamera.position.y;
+		v3.x -= currentCamera.position.x;
+		v3.y += currentCamera.position.y;
+		v4.x -= currentCamera.position.x;
+		v4.y += currentCamera.position.y;
+
+		//Apply camera zoom
+		//if(renderer->currentCamera.zoom != 1)
+		{
+
+			glm::vec2 cameraCenter;
+			cameraCenter.x = windowW / 2.0f;
+			cameraCenter.y = -windowH / 2.0f;
+
+			v1 = scaleAroundPoint(v1, cameraCenter, currentCamera.zoom);
+			v3 = scaleAroundPoint(v3, cameraCenter, currentCamera.zoom);
+		}
+
+		v1.x = internal::positionToScreenCoordsX(v1.x, (float)windowW);
+		v3.x = internal::positionToScreenCoordsX(v3.x, (float)windowW);
+		v1.y = internal::positionToScreenCoordsY(v1.y, (float)windowH);
+		v3.y = internal::positionToScreenCoordsY(v3.y, (float)windowH);
+
+		return glm::vec4(v1.x, v1.y, v3.x, v3.y);
+	}
+
+	glm::vec2 Renderer2D::getTextSize(const char *text, const Font font,
+		const float size, const float spacing, const float line_space)
+	{
+		if (font.texture.id == 0)
+		{
+			errorFunc("Missing font", userDefinedData);
+			return {};
+		}
+
+		glm::vec2 position = {};
+
+		const int text_length = (int)strlen(text);
+		Rect rectangle = {};
+		rectangle.x = position.x;
+		float linePositionY = position.y;
+
+		//This is the y position we render at because it advances when we encounter newlines
+		float maxPos = 0;
+		float maxPosY = 0;
+		float bonusY = 0;
+
+		const char *end = text + text_length;
+		for (const char *it = text; it < end;)
+		{
+			const uint32_t c = internal::decodeUTF8(it, end);
+
+			if (c == '\n')
+			{
+				rectangle.x = position.x;
+				linePositionY += (font.max_height + line_space) * size;
+				bonusY += (font.max_height + line_space) * size;
+				maxPosY = 0;
+			}
+			else if (c == '\t')
+			{
+				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
+				(font, '_');
+				auto x = quad.x1 - quad.x0;
+
+				rectangle.x += x * size * 3 + spacing * size;
+			}
+			else if (c == ' ')
+			{
+				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
+				(font, '_');
+				auto x = quad.x1 - quad.x0;
+
+				rectangle.x += x * size + spacing * size;
+			}
+			else if (c > ' ')
+			{
+				internal::FontGlyph glyph;
+				if (!internal::fontGetGlyph(font, c, glyph))
+				{
+					continue;
+				}
+
+				rectangle.z = glyph.quad.z - glyph.quad.x;
+				rectangle.w = glyph.quad.w - glyph.quad.y;
+
+				rectangle.z *= size;
+				rectangle.w *= size;
+
+				rectangle.y = linePositionY + glyph.quad.y * size;
+
+				rectangle.x += rectangle.z + spacing * size;
+
+				maxPosY = std::max(maxPosY, rectangle.y);
+				maxPos = std::max(maxPos, rectangle.x);
+			}
+		}
+
+		maxPos = std::max(maxPos, rectangle.x);
+		maxPosY = std::max(maxPosY, rectangle.y);
+
+		float paddX = maxPos;
+
+		float paddY = maxPosY;
+
+		paddY += font.max_height * size + bonusY;
+
+		return glm::vec2{paddX, paddY};
+
+	}
+
+	float Renderer2D::determineTextRescaleFitSmaller(const std::string &str,
+		gl2d::Font &f, glm::vec4 transform, float maxSize)
+	{
+		auto s = getTextSizeUnit(str, f) * maxSize;
+
+		float ratioX = transform.z / s.x;
+		float ratioY = transform.w / s.y;
+
+
+		if (ratioX > 1 && ratioY > 1)
+		{
+			return maxSize;
+		}
+		else
+		{
+			if (ratioX < ratioY)
+			{
+				return maxSize*ratioX;
+			}
+			else
+			{
+				return maxSize * ratioY;
+			}
+		}
+	}
+
+
+	float Renderer2D::determineTextRescaleFitBigger(const std::string &str,
+		gl2d::Font &f, glm::vec4 transform, float minSize)
+	{
+		auto s = getTextSizeUnit(str, f) * minSize;
+
+		float ratioX = transform.z / s.x;
+		float ratioY = transform.w / s.y;
+
+
+		if (ratioX > 1 && ratioY > 1)
+		{
+			if (ratioX > ratioY)
+			{
+				return minSize * ratioY;
+			}
+			else
+			{
+				return minSize * ratioX;
+			}
+		}
+		else
+		{
+			
+		}
+
+		return minSize;
+	
+	}
+
+	float Renderer2D::determineTextRescaleFit(const std::string &str,
+		gl2d::Font &f, glm::vec4 transform)
+	{
+		float ret = 1;
+
+		auto s = getTextSizeUnit(str, f);
+
+		float ratioX = transform.z / s.x;
+		float ratioY = transform.w / s.y;
+
+
+		if (ratioX > 1 && ratioY > 1)
+		{
+			if (ratioX > ratioY)
+			{
+				return ret * ratioY;
+			}
+			else
+			{
+				return ret * ratioX;
+			}
+		}
+		else
+		{
+			if (ratioX < ratioY)
+			{
+				return ret * ratioX;
+			}
+			else
+			{
+				return ret * ratioY;
+			}
+		}
+
+		return ret;
+	}
+
+	int Renderer2D::wrapBreaks(const char *text, const size_t textLength, const gl2d::Font &f,
+		float baseSize, float maxDimension, int *breaks, int maxBreaks, float spacing)
+	{
+		int breakCount = 0;
+		auto addBreak = [&](int position)
+		{
+			if (breaks && breakCount < maxBreaks)
+			{
+				breaks[breakCount] = position;
+			}
+			breakCount++;
+		};
+
+		//the width of a character on the line, like getTextSize measures it
+		auto advance = [&](uint32_t c) -> float
+		{
+			if (c < 128 && f.advanceTable)
+			{
+				return (f.advanceTable[c] + spacing) * baseSize;
+			}
+
+			if (c == ' ' || c == '\t')
+			{
+				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad(f, '_');
+				return ((quad.x1 - quad.x0) * (c == '\t' ? 3 : 1) + spacing) * baseSize;
+			}
+
+			internal::FontGlyph glyph;
+			if (c > ' ' && internal::fontGetGlyph(f, c, glyph))
+			{
+				return (glyph.quad.z - glyph.quad.x + spacing) * baseSize;
+			}
+
+			return 0;
+		};
+
+		float lineWidth = 0;
+		float wordStartWidth = 0; //line width before the current word
+		int wordStart = 0;
+		bool wrap = false;
+		bool firstWord = true; //the first word of a line never wraps
+
+		const char *end = text + textLength;
+		for (const char *it = text; it < end;)
+		{
+			const uint32_t c = internal::decodeUTF8(it, end);
+
+			if (c == '\n')
+			{
+				if (wrap) { addBreak(wordStart); }
+
+				lineWidth = 0;
+				wordStartWidth = 0;
+				wordStart = (int)(it - text);
+				wrap = false;
+				firstWord = true;
+			}
+			else if (c == ' ')
+			{
+				lineWidth += advance(c);
+
+				//the word (with its space) moves to the new line
+				if (wrap)
+				{
+					addBreak(wordStart);
+					lineWidth -= wordStartWidth;
+				}
+
+				wordStart = (int)(it - text);
+				wordStartWidth = lineWidth;
+				wrap = false;
+				firstWord = false;
+			}
+			else
+			{
+				lineWidth += advance(c);
+
+				if (!wrap && !firstWord && lineWidth >= maxDimension)
+				{
+					wrap = true;
+				}
+			}
+		}
+
+		if (wrap) { addBreak(wordStart); }
+
+		return breakCount;
+	}
+
+	int  Renderer2D::wrap(const std::string &in, gl2d::Font &f,
+		float baseSize, float maxDimension, std::string *outRez, float spacing)
+	{
+		int count = wrapBreaks(in.data(), in.size(), f, baseSize, maxDimension,
+			wrapBreakBuffer.data(), (int)wrapBreakBuffer.size(), spacing);
+
+		if (count > (int)wrapBreakBuffer.size())
+		{
+			wrapBreakBuffer.resize(count);
+			count = wrapBreaks(in.data(), in.size(), f, baseSize, maxDimension,
+				wrapBreakBuffer.data(), (int)wrapBreakBuffer.size(), spacing);
+		}
+
+		if (outRez)
+		{
+			outRez->clear();
+			outRez->reserve(in.size() + count);
+
+			size_t last = 0;
+			for (int i = 0; i < count; i++)
+			{
+				outRez->append(in, last, wrapBreakBuffer[i] - last);
+				outRez->push_back('\n');
+				last = wrapBreakBuffer[i];
+			}
+			outRez->append(in, last, std::string::npos);
+		}
+
+		return count + 1;
+	}
+
+	///////////////////// TextLayoutCache /////////////////////
+
+	static size_t hashTextLayout(const char *text, size_t textLength, GLuint fontTexture,
+		float size, float spacing, float lineSpace, bool center)
+	{
+		//fnv-1a
+		uint64_t h = 14695981039346656037ull;
+		auto mix = [&](const void *data, size_t count)
+		{
+			auto bytes = (const unsigned char *)data;
+			for (size_t i = 0; i < count; i++)
+			{
+				h ^= bytes[i];
+				h *= 1099511628211ull;
+			}
+		};
+
+		mix(text, textLength);
+		mix(&fontTexture, sizeof(fontTexture));
+		mix(&size, sizeof(size));
+		mix(&spacing, sizeof(spacing));
+		mix(&lineSpace, sizeof(lineSpace));
+		mix(&center, sizeof(center));
+
+		return (size_t)h;
+	}
+
+	TextLayoutCache::Entry *TextLayoutCache::find(size_t hash, const char *text, size_t textLength,
+		GLuint fontTexture, float size, float spacing, float lineSpace, bool center)
+	{
+		if (fontGeneration != gl2d::fontGeneration)
+		{
+			clear();
+			fontGeneration = gl2d::fontGeneration;
+			return nullptr;
+		}
+
+		auto found = lookup.find(hash);
+		if (found == lookup.end())
+		{
+			return nullptr;
+		}
+
+		Entry &e = *found->second;
+
+		//hash collision
+		if (e.fontTexture != fontTexture || e.size != size || e.spacing != spacing
+			|| e.lineSpace != lineSpace || e.center != center
+			|| e.text.size() != textLength || memcmp(e.text.data(), text, textLength) != 0)
+		{
+			return nullptr;
+		}
+
+		entries.splice(entries.begin(), entries, found->second);
+		return &entries.front();
+	}
+
+	TextLayoutCache::Entry &TextLayoutCache::add(size_t hash, const char *text, size_t textLength,
+		GLuint fontTexture, float size, float spacing, float lineSpace, bool center)
+	{
+		auto found = lookup.find(hash);
+		if (found != lookup.end())
+		{
+			glyphCount -= found->second->glyphs.size();
+			entries.erase(found->second);
+		}
+
+		entries.emplace_front();
+		Entry &e = entries.front();
+		e.hash = hash;
+		e.text.assign(text, textLength);
+		e.fontTexture = fontTexture;
+		e.size = size;
+		e.spacing = spacing;
+		e.lineSpace = lineSpace;
+		e.center = center;
+
+		lookup[hash] = entries.begin();
+
+		return e;
+	}
+
+	void TextLayoutCache::trim()
+	{
+		glyphCount = 0;
+		for (auto &e : entries)
+		{
+			glyphCount += e.glyphs.size();
+		}
+
+		//the most recently used entry is always kept
+		while (glyphCount > maxGlyphs && entries.size() > 1)
+		{
+			glyphCount -= entries.back().glyphs.size();
+			lookup.erase(entries.back().hash);
+			entries.pop_back();
+		}
+	}
+
+	void TextLayoutCache::clear()
+	{
+		entries.clear();
+		lookup.clear();
+		unitSizes.clear();
+		glyphCount = 0;
+	}
+
+	bool TextLayoutCache::findUnitSize(size_t hash, const std::string &text, GLuint fontTexture, glm::vec2 &size)
+	{
+		if (fontGeneration != gl2d::fontGeneration)
+		{
+			clear();
+			fontGeneration = gl2d::fontGeneration;
+			return false;
+		}
+
+		auto found = unitSizes.find(hash);
+		if (found == unitSizes.end() || found->second.fontTexture != fontTexture || found->second.text != text)
+		{
+			return false;
+		}
+
+		size = found->second.size;
+		return true;
+	}
+
+	void TextLayoutCache::addUnitSize(size_t hash, const std::string &text, GLuint fontTexture, glm::vec2 size)
+	{
+		if (unitSizes.size() >= maxUnitSizes)
+		{
+			unitSizes.clear();
+		}
+
+		auto &e = unitSizes[hash];
+		e.text = text;
+		e.fontTexture = fontTexture;
+		e.size = size;
+	}
+
+	//lays out the text relative to the position 0 0
+	static void layoutText(std::vector<TextLayoutCache::Glyph> &glyphs, const char *text, const int text_length,
+		const Font &font, const float size, const float spacing, const float line_space, bool showInCenter)
+	{
+		glyphs.clear();
+
+		float x = 0;
+		float linePositionY = 0;
+
+		float maxPos = 0;
+		float maxPosY = 0;
+
+		const char *end = text + text_length;
+		for (const char *it = text; it < end;)
+		{
+			const uint32_t c = internal::decodeUTF8(it, end);
+
+			if (c == '\n')
+			{
+				x = 0;
+				linePositionY += (font.max_height + line_space) * size;
+			}
+			else if (c == '\t')
+			{
+				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
+				(font, '_');
+				auto w = quad.x1 - quad.x0;
+
+				x += w * size * 3 + spacing * size;
+			}
+			else if (c == ' ')
+			{
+				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
+				(font, '_');
+				auto w = quad.x1 - quad.x0;
+
+				x += w * size + spacing * size;
+			}
+			else if (c > ' ')
+			{
+				internal::FontGlyph glyph;
+				if (!internal::fontGetGlyph(font, c, glyph))
+				{
+					continue;
+				}
+
+				TextLayoutCache::Glyph g;
+				g.rect.x = x;
+				g.rect.z = (glyph.quad.z - glyph.quad.x) * size;
+				g.rect.w = (glyph.quad.w - glyph.quad.y) * size;
+				g.rect.y = linePositionY + glyph.quad.y * size;
+				g.uv = glyph.uv;
+				g.texture = glyph.texture;
+				g.page = glyph.page;
+
+				x += g.rect.z + spacing * size;
+				maxPos = std::max(maxPos, x);
+
+				//glyphs without pixels only advance
+				if (!g.texture)
+				{
+					continue;
+				}
+
+				maxPosY = glyphs.empty() ? g.rect.y : std::max(maxPosY, g.rect.y);
+
+				//sdf glyphs are drawn with their padding, the outline and the shadow are there
+				if (font.sdf)
+				{
+					const float p = font.sdfPadding * size;
+					g.rect += glm::vec4{-p, -p, p * 2, p * 2};
+					g.uv += glm::vec4{-glyph.uvPadding.x, -glyph.uvPadding.y, glyph.uvPadding.x, glyph.uvPadding.y};
+				}
+
+				glyphs.push_back(g);
+			}
+		}
+
+		if (showInCenter && !glyphs.empty())
+		{
+			const glm::vec2 offset = {-maxPos / 2, -maxPosY};
+			for (auto &g : glyphs)
+			{
+				g.rect.x += offset.x;
+				g.rect.y += offset.y;
+			}
+		}
+	}
+
+	glm::vec2 Renderer2D::getTextSizeUnit(const std::string &text, const Font &font)
+	{
+		const size_t hash = hashTextLayout(text.data(), text.size(), font.texture.id, 1, 4, 3, false);
+
+		glm::vec2 size = {};
+		if (!textLayoutCache.findUnitSize(hash, text, font.texture.id, size))
+		{
+			size = getTextSize(text.c_str(), font, 1);
+			textLayoutCache.addUnitSize(hash, text, font.texture.id, size);
+		}
+
+		return size;
+	}
+
+	void Renderer2D::renderText(glm::vec2 position, const char *text, const Font font,
+		const Color4f color, const float size, const float spacing, const float line_space, bool showInCenter,
+		const Color4f ShadowColor
+		, const Color4f LightColor
+	)
+	{
+		if (font.texture.id == 0)
+		{
+			errorFunc("Missing font", userDefinedData);
+			return;
+		}
+
+		const int text_length = (int)strlen(text);
+
+		const size_t hash = hashTextLayout(text, text_length, font.texture.id, size, spacing, line_space, showInCenter);
+
+		auto layout = textLayoutCache.find(hash, text, text_length, font.texture.id,
+			size, spacing, line_space, showInCenter);
+
+		if (!layout)
+		{
+			layout = &textLayoutCache.add(hash, text, text_length, font.texture.id,
+				size, spacing, line_space, showInCenter);
+			layoutText(layout->glyphs, text, text_length, font, size, spacing, line_space, showInCenter);
+			textLayoutCache.trim();
+		}
+		else if (font.glyphCache)
+		{
+			//the pages of the cached glyphs must survive until this is flushed
+			for (auto &g : layout->glyphs)
+			{
+				font.glyphCache->touchPage(g.page);
+			}
+		}
+
+		//sdf fonts draw the shadow in the shader
+		const bool drawShadow = ShadowColor.w && !font.sdf;
+		const bool drawLight = LightColor.w && !font.sdf;
+
+		const glm::vec4 colorData[4] = {color, color, color, color};
+		const glm::vec2 shadowOffset = glm::vec2{-5, 3} * size;
+		const glm::vec2 lightOffset = glm::vec2{-2, 1} * size;
+
+		for (auto &g : layout->glyphs)
+		{
+			const Rect rectangle = {g.rect.x + position.x, g.rect.y + position.y, g.rect.z, g.rect.w};
+
+			Texture texture;
+			texture.id = g.texture;
+
+			if (drawShadow)
+			{
+				renderRectangle({rectangle.x + shadowOffset.x, rectangle.y + shadowOffset.y, rectangle.z, rectangle.w},
+					texture, ShadowColor, glm::vec2{0, 0}, 0, g.uv);
+			}
+
+			renderRectangle(rectangle, texture, colorData, glm::vec2{0, 0}, 0, g.uv);
+
+			if (drawLight)
+			{
+				renderRectangle({rectangle.x + lightOffset.x, rectangle.y + lightOffset.y, rectangle.z, rectangle.w},
+					texture, LightColor, glm::vec2{0, 0}, 0, g.uv);
+			}
+		}
+	}
+
+	void Renderer2D::renderTextWrapped(const std::string &text,
+		gl2d::Font f, glm::vec4 textPos, glm::vec4 color, float baseSize,
+		float spacing, float lineSpacing,
+		bool showInCenter, glm::vec4 shadowColor, glm::vec4 lightColor)
+	{
+		wrap(text, f, baseSize, textPos.z, &wrapScratch, spacing);
+		renderText(textPos,
+			wrapScratch.c_str(), f, color, baseSize, spacing, lineSpacing, showInCenter,
+			shadowColor, lightColor);
+	}
+
+	glm::vec2 Renderer2D::getTextSizeWrapped(const std::string &text,
+		gl2d::Font f, float maxTextLenght, float baseSize, float spacing, float lineSpacing)
+	{
+		wrap(text, f, baseSize, maxTextLenght, &wrapScratch, spacing);
+		auto rez = getTextSize(
+			wrapScratch.c_str(), f, baseSize, spacing, lineSpacing);
+
+		return rez;
+	}
+
+	void Renderer2D::clearScreen(const Color4f color)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
+	
+		#if GL2D_USE_OPENGL_130
+			GLfloat oldColor[4];
+			glGetFloatv(GL_COLOR_CLEAR_VALUE, oldColor);
+
+			glClearColor(color.r, color.g, color.b, color.a);
+			glClear(GL_COLOR_BUFFER_BIT);
+			glClearColor(oldColor[0], oldColor[1], oldColor[2], oldColor[3]);
+		#else
+			glClearBufferfv(GL_COLOR, 0, &color[0]);
+		#endif
+
+	}
+
+	void Renderer2D::setShaderProgram(const ShaderProgram shader)
+	{
+		currentShader = shader;
+	}
+
+	void Renderer2D::setCamera(const Camera camera)
+	{
+		currentCamera = camera;
+		updateTransformPipeline();
+	}
+
+	void Renderer2D::resetCameraAndShader()
+	{
+		currentCamera = defaultCamera;
+		currentShader = defaultShader;
+		updateTransformPipeline();
+	}
+
+#pragma endregion
+
+	///////////////////// TextureRegistry /////////////////////
+#pragma region TextureRegistry
+
+	struct TextureRegistryEntry
+	{
+		TextureInfo info;
+		std::vector<uint64_t> keys;
+
+		//residency
+		std::string sourceFile;
+		internal::TextureSource source = internal::textureSourceNone;
+		int blockSize = 0;
+		bool pixelated = 0;
+		bool useMipMaps = 0;
+		bool evicted = 0;
+		unsigned int lastUsedFrame = 0;
+
+		unsigned int generation = 0;
+	};
+
+	static std::unordered_map<GLuint, TextureRegistryEntry> textureRegistry;
+	static std::unordered_map<uint64_t, GLuint> textureKeys;
+	static size_t textureMemory = 0;
+	static unsigned int textureGenerationCounter = 0;
+
+	static size_t textureBudget = 0;
+	static int evictedTextureCount = 0;
+	static unsigned int textureFrameCounter = 1;
+	static TextureResidencyStats residencyStats;
+	static AsyncTextureLoader *textureReloadLoader = nullptr;
+
+	//an evicted texture keeps its info (size, mips) but only the 1x1 placeholder is in memory
+	static const size_t evictedTextureBytes = 4;
+
+	static size_t residentTextureBytes(const TextureRegistryEntry &entry)
+	{
+		return entry.evicted ? evictedTextureBytes : entry.info.bytes;
+	}
+
+	static int textureFormatBytes(GLenum internalFormat)
+	{
+		switch (internalFormat)
+		{
+			case GL_R8: case GL_RED: return 1;
+			case GL_RG8: case GL_RG: return 2;
+			case GL_RGB8: case GL_RGB: return 3;
+			case GL_RGBA16F: return 8;
+			case GL_RGBA32F: return 16;
+			default: return 4;
+		}
+	}
+
+	namespace internal
+	{
+		void registerTexture(GLuint id, glm::ivec2 size, GLenum internalFormat, bool mipMaps)
+		{
+			if (!id)
+			{
+				return;
+			}
+
+			auto &entry = textureRegistry[id];
+			auto &info = entry.info;
+			textureMemory -= residentTextureBytes(entry);
+
+			if (!entry.generation)
+			{
+				entry.generation = ++textureGenerationCounter;
+			}
+
+			info.size = size;
+			info.internalFormat = internalFormat;
+			info.mipLevels = 1;
+			info.bytes = (size_t)std::max(size.x, 0) * std::max(size.y, 0) * textureFormatBytes(internalFormat);
+
+			if (mipMaps)
+			{
+				for (glm::ivec2 s = size; s.x > 1 || s.y > 1; info.mipLevels++)
+				{
+					s = glm::max(s / 2, glm::ivec2(1));
+					info.bytes += (size_t)s.x * s.y * textureFormatBytes(internalFormat);
+				}
+			}
+
+			textureMemory += residentTextureBytes(entry);
+		}
+
+		bool releaseTexture(GLuint id)
+		{
+			auto found = textureRegistry.find(id);
+			if (found == textureRegistry.end())
+			{
+				return true;
+			}
+
+			if (--found->second.info.refCount > 0)
+			{
+				return false;
+			}
+
+			for (auto k : found->second.keys)
+			{
+				textureKeys.erase(k);
+			}
+
+			if (found->second.evicted)
+			{
+				evictedTextureCount--;
+			}
+
+			textureMemory -= residentTextureBytes(found->second);
+			textureRegistry.erase(found);
+			return true;
+		}
+
+		unsigned int getTextureGeneration(GLuint id)
+		{
+			auto found = textureRegistry.find(id);
+			return found == textureRegistry.end() ? 0 : found->second.generation;
+		}
+
+		GLuint acquireTexture(uint64_t key)
+		{
+			auto found = textureKeys.find(key);
+			if (found == textureKeys.end())
+			{
+				return 0;
+			}
+
+			textureRegistry[found->second].info.refCount++;
+			return found->second;
+		}
+
+		void addTextureKey(GLuint id, uint64_t key)
+		{
+			auto found = textureRegistry.find(id);
+			if (found == textureRegistry.end() || textureKeys.count(key))
+			{
+				return;
+			}
+
+			textureKeys[key] = id;
+			found->second.keys.push_back(key);
+		}
+	}
+
+	//what the loaded texture depends on: the path or the file data, and the load flags
+	static uint64_t textureLoadKey(const void *data, size_t size, bool isPath, int blockSize, bool pixelated, bool useMipMaps)
+	{
+		const int flags[4] = {isPath, blockSize, pixelated, useMipMaps};
+		return internal::hashFNV1a(flags, sizeof(flags), internal::hashFNV1a(data, size));
+	}
+
+	const TextureInfo *getTextureInfo(GLuint id)
+	{
+		auto found = textureRegistry.find(id);
+		return found != textureRegistry.end() ? &found->second.info : nullptr;
+	}
+
+	size_t getTextureMemoryUsage()
+	{
+		return textureMemory;
+	}
+
+	int getTextureCount()
+	{
+		return (int)textureRegistry.size();
+	}
+
+#pragma endregion
+
+	glm::ivec2 Texture::GetSize()
+	{
+		if (auto info = getTextureInfo(id))
+		{
+			return info->size;
+		}
+
+		glm::ivec2 s;
+		glBindTexture(GL_TEXTURE_2D, id);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &s.x);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &s.y);
+		return s;
+	}
+
+	void Texture::createFromBuffer(const char* image_data, const int width, const int height
+		,bool pixelated, bool useMipMaps)
+	{
+		GLuint id = 0;
+
+		glActiveTexture(GL_TEXTURE0);
+
+		glGenTextures(1, &id);
+		glBindTexture(GL_TEXTURE_2D, id);
+
+		if (pixelated)
+		{
+			if (useMipMaps)
+			{
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+			}
+			else 
+			{
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+		else 
+		{
+			if (useMipMaps)
+			{
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			}
+			else
+			{
+				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		}
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
+		if (useMipMaps)
+		{
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+
+		internal::registerTexture(id, {width, height}, GL_RGBA8, useMipMaps);
+
+		this->id = id;
+	}
+
+	void Texture::create1PxSquare(const char* b)
+	{
+		if (b == nullptr)
+		{
+			const unsigned char buff[] =
+			{
+				0xff,
+				0xff,
+				0xff,
+				0xff
+			};
+
+			createFromBuffer((char*)buff, 1, 1);
+		}
+		else
+		{
+			createFromBuffer(b, 1, 1);
+		}
+
+	}
+
+	void Texture::createFromFileData(const unsigned char* image_file_data, const size_t image_file_size
+		,bool pixelated, bool useMipMaps)
+	{
+		const uint64_t key = textureLoadKey(image_file_data, image_file_size, false, 0, pixelated, useMipMaps);
+		if (GLuint existing = internal::acquireTexture(key))
+		{
+			id = existing;
+			return;
+		}
+
+		stbi_set_flip_vertically_on_load(true);
+
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+
+		const unsigned char* decodedImage = stbi_load_from_memory(image_file_data, (int)image_file_size, &width, &height, &channels, 4);
+
+		createFromBuffer((const char*)decodedImage, width, height, pixelated, useMipMaps);
+		internal::addTextureKey(id, key);
+
+		STBI_FREE(decodedImage);
+	}
+
+	//Adds a one pixel border around every blockSize x blockSize sprite and fills it with the sprite edge.
+	static std::vector<unsigned char> addPixelPadding(const unsigned char* decodedImage, int width, int height,
+		int blockSize, int &newW, int &newH)
+	{
+		newW = width + ((width * 2) / blockSize);
+		newH = height + ((height * 2) / blockSize);
+
+		auto getOld = [decodedImage, width](int x, int y, int c)->const unsigned char
+		{
+			return decodedImage[4 * (x + (y * width)) + c];
+		};
+
+
+		std::vector<unsigned char> padded((size_t)newW * newH * 4, 0);
+		unsigned char* newData = padded.data();
+
+		auto getNew = [newData, newW](int x, int y, int c)
+		{
+			return &newData[4 * (x + (y * newW)) + c];
+		};
+
+		int newDataCursor = 0;
+		int dataCursor = 0;
+
+		//first copy data
+		for (int y = 0; y < newH; y++)
+		{
+			int yNo = 0;
+			if ((y == 0 || y == newH - 1
+				|| ((y) % (blockSize + 2)) == 0 ||
+				((y + 1) % (blockSize + 2)) == 0
+				))
+			{
+				yNo = 1;
+			}
+
+			for (int x = 0; x < newW; x++)
+			{
+				if (
+					yNo ||
+
+					((
+						x == 0 || x == newW - 1
+						|| (x % (blockSize + 2)) == 0 ||
+						((x + 1) % (blockSize + 2)) == 0
+						)
+						)
+
+					)
+				{
+					newData[newDataCursor++] = 0;
+					newData[newDataCursor++] = 0;
+					newData[newDataCursor++] = 0;
+					newData[newDataCursor++] = 0;
+				}
+				else
+				{
+					newData[newDataCursor++] = decodedImage[dataCursor++];
+					newData[newDataCursor++] = decodedImage[dataCursor++];
+					newData[newDataCursor++] = decodedImage[dataCursor++];
+					newData[newDataCursor++] = decodedImage[dataCursor++];
+				}
+
+			}
+
+		}
+
+		//then add margins
+
+
+		for (int x = 1; x < newW - 1; x++)
+		{
+			//copy on left
+			if (x == 1 ||
+				(x % (blockSize + 2)) == 1
+				)
+			{
+				for (int y = 0; y < newH; y++)
+				{
+					*getNew(x - 1, y, 0) = *getNew(x, y, 0);
+					*getNew(x - 1, y, 1) = *getNew(x, y, 1);
+					*getNew(x - 1, y, 2) = *getNew(x, y, 2);
+					*getNew(x - 1, y, 3) = *getNew(x, y, 3);
+				}
+
+			}
+			else //copy on rigght
+				if (x == newW - 2 ||
+					(x % (blockSize + 2)) == blockSize
+					)
+				{
+					for (int y = 0; y < newH; y++)
+					{
+						*getNew(x + 1, y, 0) = *getNew(x, y, 0);
+						*getNew(x + 1, y, 1) = *getNew(x, y, 1);
+						*getNew(x + 1, y, 2) = *getNew(x, y, 2);
+						*getNew(x + 1, y, 3) = *getNew(x, y, 3);
+					}
+				}
+		}
+
+		for (int y = 1; y < newH - 1; y++)
+		{
+			if (y == 1 ||
+				(y % (blockSize + 2)) == 1
+				)
+			{
+				for (int x = 0; x < newW; x++)
+				{
+					*getNew(x, y - 1, 0) = *getNew(x, y, 0);
+					*getNew(x, y - 1, 1) = *getNew(x, y, 1);
+					*getNew(x, y - 1, 2) = *getNew(x, y, 2);
+					*getNew(x, y - 1, 3) = *getNew(x, y, 3);
+				}
+			}
+			else
+				if (y == newH - 2 ||
+					(y % (blockSize + 2)) == blockSize
+					)
+				{
+					for (int x = 0; x < newW; x++)
+					{
+						*getNew(x, y + 1, 0) = *getNew(x, y, 0);
+						*getNew(x, y + 1, 1) = *getNew(x, y, 1);
+						*getNew(x, y + 1, 2) = *getNew(x, y, 2);
+						*getNew(x, y + 1, 3) = *getNew(x, y, 3);
+					}
+				}
+
+		}
+
+		return padded;
+	}
+
+	void Texture::createFromFileDataWithPixelPadding(const unsigned char* image_file_data, const size_t image_file_size, int blockSize,
+		bool pixelated, bool useMipMaps)
+	{
+		const uint64_t key = textureLoadKey(image_file_data, image_file_size, false, blockSize, pixelated, useMipMaps);
+		if (GLuint existing = internal::acquireTexture(key))
+		{
+			id = existing;
+			return;
+		}
+
+		stbi_set_flip_vertically_on_load(true);
 
-		//bottomleft
-		Rect bottomleft = position;
-		bottomleft.y += position.w - bottomBorder;
-		bottomleft.z = leftBorder;
-		bottomleft.w = bottomBorder;
-		glm::vec4 bottomleftTexPos;
-		bottomleftTexPos.x = textureCoords.x;
-		bottomleftTexPos.y = inner_texture_coords.w;
-		bottomleftTexPos.z = inner_texture_coords.x;
-		bottomleftTexPos.w = textureCoords.w;
-		renderRectangle(bottomleft, texture, colorData, Position2D{ 0, 0 }, 0, bottomleftTexPos);
+		int width = 0;
+		int height = 0;
+		int channels = 0;
 
-		//bottomright
-		Rect bottomright = position;
-		bottomright.y += position.w - bottomBorder;
-		bottomright.x += position.z - rightBorder;
-		bottomright.z = rightBorder;
-		bottomright.w = bottomBorder;
-		glm::vec4 bottomrightTexPos;
-		bottomrightTexPos.x = inner_texture_coords.z;
-		bottomrightTexPos.y = inner_texture_coords.w;
-		bottomrightTexPos.z = textureCoords.z;
-		bottomrightTexPos.w = textureCoords.w;
-		renderRectangle(bottomright, texture, colorData, Position2D{ 0, 0 }, 0, bottomrightTexPos);
+		const unsigned char* decodedImage = stbi_load_from_memory(image_file_data, (int)image_file_size, &width, &height, &channels, 4);
+
+		int newW = 0;
+		int newH = 0;
+		std::vector<unsigned char> newData = addPixelPadding(decodedImage, width, height, blockSize, newW, newH);
 
+		createFromBuffer((const char*)newData.data(), newW, newH, pixelated, useMipMaps);
+		internal::addTextureKey(id, key);
+
+		STBI_FREE(decodedImage);
 	}
 
-	void Renderer2D::create(GLuint fbo, size_t quadCount)
+	void Texture::loadFromFile(const char* fileName, bool pixelated, bool useMipMaps)
 	{
-		if (!hasInitialized)
+		const uint64_t key = textureLoadKey(fileName, strlen(fileName), true, 0, pixelated, useMipMaps);
+		if (GLuint existing = internal::acquireTexture(key))
 		{
-			errorFunc("Library not initialized. Have you forgotten to call gl2d::init() ?", userDefinedData);
+			id = existing;
+			return;
 		}
 
-		defaultFBO = fbo;
+		std::ifstream file(fileName, std::ios::binary);
 
-		clearDrawData();
-		spritePositions.reserve(quadCount * 6);
-		spriteColors.reserve(quadCount * 6);
-		texturePositions.reserve(quadCount * 6);
-		spriteTextures.reserve(quadCount);
+		if (!file.is_open())
+		{
+			char c[300] = { 0 };
+			strcat(c, "error openning: ");
+			strcat(c + strlen(c), fileName);
+			errorFunc(c, userDefinedData);
+			return;
+		}
 
-		this->resetCameraAndShader();
+		int fileSize = 0;
+		file.seekg(0, std::ios::end);
+		fileSize = (int)file.tellg();
+		file.seekg(0, std::ios::beg);
+		unsigned char* fileData = new unsigned char[fileSize];
+		file.read((char*)fileData, fileSize);
+		file.close();
 
-		glGenVertexArrays(1, &vao);
-		glBindVertexArray(vao);
+		createFromFileData(fileData, fileSize, pixelated, useMipMaps);
+		internal::addTextureKey(id, key);
+		internal::setTextureSource(id, fileName, internal::textureSourceFile, 0, pixelated, useMipMaps);
 
-		glGenBuffers(Renderer2DBufferType::bufferSize, buffers);
+		delete[] fileData;
 
-		glBindBuffer(GL_ARRAY_BUFFER, buffers[Renderer2DBufferType::quadPositions]);
-		glEnableVertexAttribArray(0);
-		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	}
 
-		glBindBuffer(GL_ARRAY_BUFFER, buffers[Renderer2DBufferType::quadColors]);
-		glEnableVertexAttribArray(1);
-		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	void Texture::loadFromFileWithPixelPadding(const char* fileName, int blockSize,
+		bool pixelated, bool useMipMaps)
+	{
+		const uint64_t key = textureLoadKey(fileName, strlen(fileName), true, blockSize, pixelated, useMipMaps);
+		if (GLuint existing = internal::acquireTexture(key))
+		{
+			id = existing;
+			return;
+		}
 
-		glBindBuffer(GL_ARRAY_BUFFER, buffers[Renderer2DBufferType::texturePositions]);
-		glEnableVertexAttribArray(2);
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
+		std::ifstream file(fileName, std::ios::binary);
+
+		if (!file.is_open())
+		{
+			char c[300] = { 0 };
+			strcat(c, "error openning: ");
+			strcat(c + strlen(c), fileName);
+			errorFunc(c, userDefinedData);
+			return;
+		}
+
+		int fileSize = 0;
+		file.seekg(0, std::ios::end);
+		fileSize = (int)file.tellg();
+		file.seekg(0, std::ios::beg);
+		unsigned char* fileData = new unsigned char[fileSize];
+		file.read((char*)fileData, fileSize);
+		file.close();
+
+		createFromFileDataWithPixelPadding(fileData, fileSize, blockSize, pixelated, useMipMaps);
+		internal::addTextureKey(id, key);
+		internal::setTextureSource(id, fileName, internal::textureSourcePaddedFile, blockSize, pixelated, useMipMaps);
+
+		delete[] fileData;
 
-		glBindVertexArray(0);
 	}
 
-	void Renderer2D::cleanup()
+	///////////////////// Baked textures /////////////////////
+
+	//file layout: header, then every mip level (RGBA8, bottom row first) from the biggest one
+	struct BakedTextureHeader
 	{
-		glDeleteVertexArrays(1, &vao);
-		glDeleteBuffers(Renderer2DBufferType::bufferSize, buffers);
+		char     magic[8] = {'g', 'l', '2', 'd', 't', 'e', 'x', 0};
+		uint32_t version = 1;
+		uint32_t format = GL_RGBA8;
+		int32_t  width = 0;
+		int32_t  height = 0;
+		int32_t  mipLevels = 0;
+		int32_t  blockSize = 0;
+	};
+
+	static size_t bakedLevelBytes(glm::ivec2 size, int level)
+	{
+		const glm::ivec2 s = glm::max(size >> level, glm::ivec2(1));
+		return (size_t)s.x * s.y * 4;
 	}
 
-	void Renderer2D::pushShader(ShaderProgram s)
+	//box filter, odd sizes clamp the last row or column
+	static void downsampleRGBA(const unsigned char *src, glm::ivec2 srcSize, unsigned char *dst, glm::ivec2 dstSize)
 	{
-		shaderPushPop.push_back(currentShader);
-		currentShader = s;
+		for (int y = 0; y < dstSize.y; y++)
+		{
+			const int y0 = std::min(y * 2, srcSize.y - 1);
+			const int y1 = std::min(y * 2 + 1, srcSize.y - 1);
+
+			for (int x = 0; x < dstSize.x; x++)
+			{
+				const int x0 = std::min(x * 2, srcSize.x - 1);
+				const int x1 = std::min(x * 2 + 1, srcSize.x - 1);
+
+				for (int c = 0; c < 4; c++)
+				{
+					const int sum = src[(y0 * srcSize.x + x0) * 4 + c] + src[(y0 * srcSize.x + x1) * 4 + c]
+						+ src[(y1 * srcSize.x + x0) * 4 + c] + src[(y1 * srcSize.x + x1) * 4 + c];
+					dst[(y * dstSize.x + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
 	}
 
-	void Renderer2D::popShader()
+	bool bakeTexture(const char* imageFile, const char* bakedFile, int blockSize, bool useMipMaps)
 	{
-		if (shaderPushPop.empty())
+		internal::MappedFile file;
+		if (!file.open(imageFile))
 		{
-			errorFunc("Pop on an empty stack on popShader", userDefinedData);
+			char c[300] = {0};
+			strcat(c, "error openning: ");
+			strncat(c + strlen(c), imageFile, 250);
+			errorFunc(c, userDefinedData);
+			return false;
 		}
-		else
+
+		stbi_set_flip_vertically_on_load(true);
+
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+
+		unsigned char* decodedImage = stbi_load_from_memory(file.data, (int)file.size, &width, &height, &channels, 4);
+		if (!decodedImage)
 		{
-			currentShader = shaderPushPop.back();
-			shaderPushPop.pop_back();
+			errorFunc("error decoding the image to bake", userDefinedData);
+			return false;
 		}
-	}
 
-	void Renderer2D::pushCamera(Camera c)
-	{
-		cameraPushPop.push_back(currentCamera);
-		currentCamera = c;
-	}
+		std::vector<unsigned char> level;
+		glm::ivec2 size = {width, height};
 
-	void Renderer2D::popCamera()
-	{
-		if (cameraPushPop.empty())
+		if (blockSize > 0)
 		{
-			errorFunc("Pop on an empty stack on popCamera", userDefinedData);
+			level = addPixelPadding(decodedImage, width, height, blockSize, size.x, size.y);
 		}
 		else
 		{
-			currentCamera = cameraPushPop.back();
-			cameraPushPop.pop_back();
+			level.assign(decodedImage, decodedImage + (size_t)width * height * 4);
 		}
-	}
 
-	glm::vec4 Renderer2D::getViewRect()
-	{
-		auto rect = glm::vec4{0, 0, windowW, windowH};
+		STBI_FREE(decodedImage);
 
-		glm::mat3 mat = 
-		{1.f, 0, currentCamera.position.x ,
-		 0, 1.f, currentCamera.position.y,
-		 0, 0, 1.f};
-		mat = glm::transpose(mat);
+		BakedTextureHeader header;
+		header.width = size.x;
+		header.height = size.y;
+		header.mipLevels = 1;
+		header.blockSize = blockSize;
 
-		glm::vec3 pos1 = {rect.x, rect.y, 1.f};
-		glm::vec3 pos2 = {rect.z + rect.x, rect.w + rect.y, 1.f};
+		if (useMipMaps)
+		{
+			for (glm::ivec2 s = size; s.x > 1 || s.y > 1; header.mipLevels++)
+			{
+				s = glm::max(s / 2, glm::ivec2(1));
+			}
+		}
 
-		pos1 = mat * pos1;
-		pos2 = mat * pos2;
-		
-		glm::vec2 point((pos1.x + pos2.x) / 2.f, (pos1.y + pos2.y) / 2.f);
+		std::ofstream out(bakedFile, std::ios::binary);
+		if (!out.is_open())
+		{
+			char c[300] = {0};
+			strcat(c, "error openning: ");
+			strncat(c + strlen(c), bakedFile, 250);
+			errorFunc(c, userDefinedData);
+			return false;
+		}
 
-		pos1 = glm::vec3(scaleAroundPoint(pos1, point, 1.f/currentCamera.zoom), 1.f);
-		pos2 = glm::vec3(scaleAroundPoint(pos2, point, 1.f/currentCamera.zoom), 1.f);
+		out.write((const char*)&header, sizeof(header));
+		out.write((const char*)level.data(), level.size());
 
-		rect = {pos1.x, pos1.y, pos2.x - pos1.x, pos2.y - pos1.y};
+		std::vector<unsigned char> next;
+		for (int l = 1; l < header.mipLevels; l++)
+		{
+			const glm::ivec2 srcSize = glm::max(size >> (l - 1), glm::ivec2(1));
+			const glm::ivec2 dstSize = glm::max(size >> l, glm::ivec2(1));
 
-		return rect;
+			next.resize(bakedLevelBytes(size, l));
+			downsampleRGBA(level.data(), srcSize, next.data(), dstSize);
+			out.write((const char*)next.data(), next.size());
+
+			std::swap(level, next);
+		}
+
+		return out.good();
 	}
 
-	glm::vec4 Renderer2D::toScreen(const glm::vec4& transform)
+	//uploads every level of a baked file into the texture, also used to reload evicted textures
+	static bool uploadBakedTexture(GLuint id, const char* fileName, bool pixelated)
 	{
-		//We need to flip texture_transforms.y
-		const float transformsY = transform.y * -1;
+		internal::MappedFile file;
+		if (!file.open(fileName))
+		{
+			char c[300] = {0};
+			strcat(c, "error openning: ");
+			strncat(c + strlen(c), fileName, 250);
+			errorFunc(c, userDefinedData);
+			return false;
+		}
 
-		glm::vec2 v1 = { transform.x,				  transformsY };
-		glm::vec2 v2 = { transform.x,				  transformsY - transform.w };
-		glm::vec2 v3 = { transform.x + transform.z, transformsY - transform.w };
-		glm::vec2 v4 = { transform.x + transform.z, transformsY };
+		BakedTextureHeader header;
+		const BakedTextureHeader expected;
+		bool valid = file.size >= sizeof(header);
 
-		//Apply camera transformations
-		v1.x -= currentCamera.position.x;
-		v1.y += currentCamera.position.y;
-		v2.x -= currentCamera.position.x;
-		v2.y += currentCamera.position.y;
-		v3.x -= currentCamera.position.x;
-		v3.y += currentCamera.position.y;
-		v4.x -= currentCamera.position.x;
-		v4.y += currentCamera.position.y;
+		if (valid)
+		{
+			memcpy(&header, file.data, sizeof(header));
+			valid = !memcmp(header.magic, expected.magic, sizeof(header.magic)) && header.version == expected.version
+				&& header.format == expected.format && header.width > 0 && header.height > 0
+				&& header.mipLevels > 0 && header.mipLevels <= 32;
+		}
 
-		//Apply camera zoom
-		//if(renderer->currentCamera.zoom != 1)
+		const glm::ivec2 size = {header.width, header.height};
+		size_t expectedSize = sizeof(header);
+		for (int l = 0; valid && l < header.mipLevels; l++)
+		{
+			expectedSize += bakedLevelBytes(size, l);
+		}
+
+		if (!valid || file.size != expectedSize)
+		{
+			char c[300] = {0};
+			strcat(c, "invalid baked texture: ");
+			strncat(c + strlen(c), fileName, 250);
+			errorFunc(c, userDefinedData);
+			return false;
+		}
+
+		const bool mipMaps = header.mipLevels > 1;
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, id);
+
+		if (pixelated)
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipMaps ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		}
+		else
+		{
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mipMaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		}
+
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header.mipLevels - 1);
+
+		const unsigned char *level = file.data + sizeof(header);
+		for (int l = 0; l < header.mipLevels; l++)
+		{
+			const glm::ivec2 s = glm::max(size >> l, glm::ivec2(1));
+			glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, s.x, s.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, level);
+			level += bakedLevelBytes(size, l);
+		}
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		internal::registerTexture(id, size, GL_RGBA8, mipMaps);
+		return true;
+	}
+
+	void Texture::loadFromBakedFile(const char* fileName, bool pixelated)
+	{
+		const uint64_t key = textureLoadKey(fileName, strlen(fileName), true, -1, pixelated, true);
+		if (GLuint existing = internal::acquireTexture(key))
 		{
+			id = existing;
+			return;
+		}
 
-			glm::vec2 cameraCenter;
-			cameraCenter.x = windowW / 2.0f;
-			cameraCenter.y = -windowH / 2.0f;
+		glGenTextures(1, &id);
 
-			v1 = scaleAroundPoint(v1, cameraCenter, currentCamera.zoom);
-			v3 = scaleAroundPoint(v3, cameraCenter, currentCamera.zoom);
+		if (!uploadBakedTexture(id, fileName, pixelated))
+		{
+			glDeleteTextures(1, &id);
+			id = 0;
+			return;
 		}
 
-		v1.x = internal::positionToScreenCoordsX(v1.x, (float)windowW);
-		v3.x = internal::positionToScreenCoordsX(v3.x, (float)windowW);
-		v1.y = internal::positionToScreenCoordsY(v1.y, (float)windowH);
-		v3.y = internal::positionToScreenCoordsY(v3.y, (float)windowH);
+		internal::addTextureKey(id, key);
+		internal::setTextureSource(id, fileName, internal::textureSourceBakedFile, 0, pixelated, true);
+	}
 
-		return glm::vec4(v1.x, v1.y, v3.x, v3.y);
+	///////////////////// TextureResidency /////////////////////
+#pragma region TextureResidency
+
+	void setTextureMemoryBudget(size_t bytes)
+	{
+		textureBudget = bytes;
 	}
 
-	glm::vec2 Renderer2D::getTextSize(const char *text, const Font font,
-		const float size, const float spacing, const float line_space)
+	void setTextureReloadLoader(AsyncTextureLoader *loader)
 	{
-		if (font.texture.id == 0)
+		textureReloadLoader = loader;
+	}
+
+	TextureResidencyStats getTextureResidencyStats()
+	{
+		TextureResidencyStats stats = residencyStats;
+		stats.budget = textureBudget;
+		stats.usedBytes = textureMemory;
+		stats.evictedTextures = evictedTextureCount;
+		return stats;
+	}
+
+	static void evictTexture(GLuint id, TextureRegistryEntry &entry)
+	{
+		residencyStats.evictions++;
+		residencyStats.evictedBytes += entry.info.bytes;
+
+		//the id stays valid, the storage of every level is dropped
+		const unsigned char white[4] = {0xff, 0xff, 0xff, 0xff};
+		glBindTexture(GL_TEXTURE_2D, id);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, white);
+		for (int l = 1; l < entry.info.mipLevels; l++)
 		{
-			errorFunc("Missing font", userDefinedData);
-			return {};
+			glTexImage2D(GL_TEXTURE_2D, l, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
 		}
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		glBindTexture(GL_TEXTURE_2D, 0);
 
-		glm::vec2 position = {};
+		//the info still describes the real texture, so GetSize doesn't change
+		textureMemory -= entry.info.bytes;
+		textureMemory += evictedTextureBytes;
+		entry.evicted = true;
+		evictedTextureCount++;
+	}
 
-		const int text_length = (int)strlen(text);
-		Rect rectangle = {};
-		rectangle.x = position.x;
-		float linePositionY = position.y;
+	//called after the texture was uploaded again (registerTexture still counts the placeholder)
+	static void markTextureResident(TextureRegistryEntry &entry)
+	{
+		if (!entry.evicted)
+		{
+			return;
+		}
 
-		//This is the y position we render at because it advances when we encounter newlines
-		float maxPos = 0;
-		float maxPosY = 0;
-		float bonusY = 0;
+		textureMemory -= evictedTextureBytes;
+		textureMemory += entry.info.bytes;
+		entry.evicted = false;
+		evictedTextureCount--;
+		residencyStats.reloads++;
+	}
 
-		for (int i = 0; i < text_length; i++)
+	//The texture stays evicted until the upload succeeded, so a failed reload
+	//is tried again the next time the texture is drawn.
+	static void reloadTexture(GLuint id, TextureRegistryEntry &entry)
+	{
+		if (entry.source == internal::textureSourceBakedFile)
 		{
-			if (text[i] == '\n')
+			if (uploadBakedTexture(id, entry.sourceFile.c_str(), entry.pixelated))
 			{
-				rectangle.x = position.x;
-				linePositionY += (font.max_height + line_space) * size;
-				bonusY += (font.max_height + line_space) * size;
-				maxPosY = 0;
+				markTextureResident(entry);
 			}
-			else if (text[i] == '\t')
-			{
-				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-				(font, '_');
-				auto x = quad.x1 - quad.x0;
+			return;
+		}
 
-				rectangle.x += x * size * 3 + spacing * size;
-			}
-			else if (text[i] == ' ')
-			{
-				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-				(font, '_');
-				auto x = quad.x1 - quad.x0;
+		if (textureReloadLoader && entry.source == internal::textureSourceFile)
+		{
+			Texture t;
+			t.id = id;
 
-				rectangle.x += x * size + spacing * size;
-			}
-			else if (text[i] >= ' ' && text[i] <= '~')
+			//does nothing if it is already loading, the entry may be gone when it finishes
+			const unsigned int generation = entry.generation;
+			textureReloadLoader->reload(t, entry.sourceFile.c_str(), entry.pixelated, entry.useMipMaps,
+				[generation](Texture texture, bool succeeded)
 			{
-				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-				(font, text[i]);
+				auto found = textureRegistry.find(texture.id);
+				if (succeeded && found != textureRegistry.end() && found->second.generation == generation)
+				{
+					markTextureResident(found->second);
+				}
+			});
+			return;
+		}
 
-				rectangle.z = quad.x1 - quad.x0;
-				rectangle.w = quad.y1 - quad.y0;
+		internal::MappedFile file;
+		unsigned char* decodedImage = nullptr;
+		glm::ivec2 size = {};
 
-				rectangle.z *= size;
-				rectangle.w *= size;
+		if (file.open(entry.sourceFile.c_str()))
+		{
+			int channels = 0;
+			stbi_set_flip_vertically_on_load(true);
+			decodedImage = stbi_load_from_memory(file.data, (int)file.size, &size.x, &size.y, &channels, 4);
+		}
 
-				rectangle.y = linePositionY + quad.y0 * size;
+		if (!decodedImage)
+		{
+			char c[300] = {0};
+			strcat(c, "error reloading: ");
+			strncat(c + strlen(c), entry.sourceFile.c_str(), 250);
+			errorFunc(c, userDefinedData);
+			return;
+		}
 
-				rectangle.x += rectangle.z + spacing * size;
+		std::vector<unsigned char> padded;
+		const unsigned char* pixels = decodedImage;
 
-				maxPosY = std::max(maxPosY, rectangle.y);
-				maxPos = std::max(maxPos, rectangle.x);
-			}
+		if (entry.source == internal::textureSourcePaddedFile)
+		{
+			padded = addPixelPadding(decodedImage, size.x, size.y, entry.blockSize, size.x, size.y);
+			pixels = padded.data();
 		}
 
-		maxPos = std::max(maxPos, rectangle.x);
-		maxPosY = std::max(maxPosY, rectangle.y);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, id);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		if (entry.useMipMaps)
+		{
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
 
-		float paddX = maxPos;
+		STBI_FREE(decodedImage);
 
-		float paddY = maxPosY;
+		internal::registerTexture(id, size, GL_RGBA8, entry.useMipMaps);
+		markTextureResident(entry);
+	}
 
-		paddY += font.max_height * size + bonusY;
+	namespace internal
+	{
+		void setTextureSource(GLuint id, const char *fileName, TextureSource source, int blockSize,
+			bool pixelated, bool useMipMaps)
+		{
+			auto found = textureRegistry.find(id);
+			if (found == textureRegistry.end())
+			{
+				return;
+			}
 
-		return glm::vec2{paddX, paddY};
+			auto &entry = found->second;
+			entry.sourceFile = fileName;
+			entry.source = source;
+			entry.blockSize = blockSize;
+			entry.pixelated = pixelated;
+			entry.useMipMaps = useMipMaps;
+			entry.lastUsedFrame = textureFrameCounter;
+		}
 
-	}
+		void touchTexture(GLuint id)
+		{
+			if (!textureBudget && !evictedTextureCount)
+			{
+				return;
+			}
 
-	float Renderer2D::determineTextRescaleFitSmaller(const std::string &str,
-		gl2d::Font &f, glm::vec4 transform, float maxSize)
-	{
-		auto s = getTextSize(str.c_str(), f, maxSize);
+			auto found = textureRegistry.find(id);
+			if (found == textureRegistry.end())
+			{
+				return;
+			}
 
-		float ratioX = transform.z / s.x;
-		float ratioY = transform.w / s.y;
+			found->second.lastUsedFrame = textureFrameCounter;
 
+			if (found->second.evicted)
+			{
+				reloadTexture(id, found->second);
+			}
+		}
 
-		if (ratioX > 1 && ratioY > 1)
+		void advanceTextureFrame()
 		{
-			return maxSize;
+			textureFrameCounter++;
 		}
-		else
+
+		void evictTextures()
 		{
-			if (ratioX < ratioY)
+			if (!textureBudget || textureMemory <= textureBudget)
 			{
-				return maxSize*ratioX;
+				return;
 			}
-			else
+
+			static std::vector<std::pair<unsigned int, GLuint>> candidates;
+			candidates.clear();
+
+			for (auto &t : textureRegistry)
 			{
-				return maxSize * ratioY;
+				auto &e = t.second;
+
+				//1x1 are placeholders of textures that are still loading
+				if (e.source != textureSourceNone && !e.evicted && e.info.size != glm::ivec2(1, 1)
+					&& e.lastUsedFrame + GL2D_TEXTURE_EVICTION_MIN_AGE <= textureFrameCounter)
+				{
+					candidates.push_back({e.lastUsedFrame, t.first});
+				}
+			}
+
+			std::sort(candidates.begin(), candidates.end());
+
+			for (auto &c : candidates)
+			{
+				if (textureMemory <= textureBudget)
+				{
+					break;
+				}
+
+				evictTexture(c.second, textureRegistry[c.second]);
 			}
 		}
 	}
 
+#pragma endregion
 
-	float Renderer2D::determineTextRescaleFitBigger(const std::string &str,
-		gl2d::Font &f, glm::vec4 transform, float minSize)
+	void Texture::bind(const unsigned int sample)
 	{
-		auto s = getTextSize(str.c_str(), f, minSize);
-
-		float ratioX = transform.z / s.x;
-		float ratioY = transform.w / s.y;
+		glActiveTexture(GL_TEXTURE0 + sample);
+		glBindTexture(GL_TEXTURE_2D, id);
+	}
 
+	void Texture::unbind()
+	{
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
 
-		if (ratioX > 1 && ratioY > 1)
-		{
-			if (ratioX > ratioY)
-			{
-				return minSize * ratioY;
-			}
-			else
-			{
-				return minSize * ratioX;
-			}
-		}
-		else
+	void Texture::cleanup()
+	{
+		if (internal::releaseTexture(id))
 		{
-			
+			glDeleteTextures(1, &id);
 		}
 
-		return minSize;
-	
+		id = 0;
 	}
 
-	float Renderer2D::determineTextRescaleFit(const std::string &str,
-		gl2d::Font &f, glm::vec4 transform)
-	{
-		float ret = 1;
+	///////////////////// AsyncTextureLoader /////////////////////
+#pragma region AsyncTextureLoader
 
-		auto s = getTextSize(str.c_str(), f, ret);
+	void AsyncTextureLoader::create(int workerCount, float uploadBudgetMs)
+	{
+		cleanup();
 
-		float ratioX = transform.z / s.x;
-		float ratioY = transform.w / s.y;
+		this->uploadBudgetMs = uploadBudgetMs;
 
+		glGenBuffers(1, &pbo);
 
-		if (ratioX > 1 && ratioY > 1)
+		stopping = false;
+		for (int i = 0; i < std::max(workerCount, 1); i++)
 		{
-			if (ratioX > ratioY)
-			{
-				return ret * ratioY;
-			}
-			else
-			{
-				return ret * ratioX;
-			}
+			workers.emplace_back(&AsyncTextureLoader::workerLoop, this);
 		}
-		else
+	}
+
+	void AsyncTextureLoader::stopWorkers()
+	{
 		{
-			if (ratioX < ratioY)
-			{
-				return ret * ratioX;
-			}
-			else
-			{
-				return ret * ratioY;
-			}
+			std::lock_guard<std::mutex> lock(mutex);
+			stopping = true;
 		}
+		wake.notify_all();
 
-		return ret;
+		for (auto &w : workers)
+		{
+			w.join();
+		}
+		workers.clear();
 	}
 
-	int  Renderer2D::wrap(const std::string &in, gl2d::Font &f,
-		float baseSize, float maxDimension, std::string *outRez)
+	void AsyncTextureLoader::cleanup()
 	{
-		if (outRez)
+		stopWorkers();
+
+		if (uploadMemory)
 		{
-			*outRez = "";
-			outRez->reserve(in.size() + 10);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+			glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			uploadMemory = nullptr;
 		}
 
-		std::string word = "";
-		std::string currentLine = "";
-		currentLine.reserve(in.size() + 10);
+		if (pbo)
+		{
+			glDeleteBuffers(1, &pbo);
+			pbo = 0;
+		}
 
-		bool wrap = 0;
-		bool newLine = 1;
-		int newLineCounter = 0;
+		//the workers are stopped so every job is in one of the queues or uploading
+		//(jobs of deleted textures aren't in loading anymore)
+		for (auto *jobs : {&requests, &decoded})
+		{
+			for (auto *j : *jobs)
+			{
+				STBI_FREE(j->pixels);
+				delete j;
+			}
+			jobs->clear();
+		}
 
-		for (int i = 0; i < in.size(); i++)
+		if (uploading)
 		{
-			word.push_back(in[i]);
-			currentLine.push_back(in[i]);
+			STBI_FREE(uploading->pixels);
+			delete uploading;
+			uploading = nullptr;
+		}
 
-			if (in[i] == ' ')
-			{
-				if (wrap)
-				{
-					if (outRez)
-					{
-						outRez->push_back('\n'); currentLine = "";
-					}
-					newLineCounter++;
+		loading.clear();
+	}
 
-				}
+	Texture AsyncTextureLoader::load(const char *fileName, bool pixelated, bool useMipMaps, Callback callback)
+	{
+		Texture t;
 
-				if (outRez)
-				{
-					*outRez += word;
-				}
-				word = "";
-				wrap = 0;
-				newLine = false;
-			}
-			else if (in[i] == '\n')
+		//same key as Texture::loadFromFile so both share the texture
+		const uint64_t key = textureLoadKey(fileName, strlen(fileName), true, 0, pixelated, useMipMaps);
+		if ((t.id = internal::acquireTexture(key)))
+		{
+			auto pending = loading.find(t.id);
+			if (pending != loading.end() && !isStale(pending->second))
 			{
-				if (wrap)
+				if (callback)
 				{
-					if (outRez)
+					auto first = std::move(pending->second->callback);
+					pending->second->callback = [first, callback](Texture texture, bool succeeded)
 					{
-						outRez->push_back('\n');
-					}
-					newLineCounter++;
-				}
-
-				currentLine = "";
-
-				if (outRez)
-				{
-					*outRez += word;
+						if (first) { first(texture, succeeded); }
+						callback(texture, succeeded);
+					};
 				}
-				word = "";
-				wrap = 0;
-				newLine = true;
 			}
-			else
+			else if (callback)
 			{
-				//let's check, only if needed
-				if (!wrap && !newLine)
-				{
-					float size = baseSize;
-					auto textSize = getTextSize(currentLine.c_str(), f, size);
-
-					if (textSize.x >= maxDimension && !newLine)
-					{
-						//wrap last word
-						wrap = 1;
-					}
-				};
+				callback(t, true);
 			}
 
+			return t;
 		}
 
+		t.create1PxSquare();
+
+		if (workers.empty())
 		{
-			if (wrap) { if (outRez)outRez->push_back('\n'); newLineCounter++; }
+			errorFunc("AsyncTextureLoader not initialized. Have you forgotten to call create() ?", userDefinedData);
+			return t;
+		}
 
-			if (outRez)
-			{
-				*outRez += word;
-			}
+		//the placeholder uses the same sampling as the final texture
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, pixelated ?
+			(useMipMaps ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST) : (useMipMaps ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR));
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, pixelated ? GL_NEAREST : GL_LINEAR);
+
+		internal::addTextureKey(t.id, key);
+		internal::setTextureSource(t.id, fileName, internal::textureSourceFile, 0, pixelated, useMipMaps);
+
+		queue(t.id, fileName, pixelated, useMipMaps, std::move(callback));
+
+		return t;
+	}
+
+	void AsyncTextureLoader::reload(Texture texture, const char *fileName, bool pixelated, bool useMipMaps, Callback callback)
+	{
+		if (workers.empty())
+		{
+			errorFunc("AsyncTextureLoader not initialized. Have you forgotten to call create() ?", userDefinedData);
+			return;
+		}
+
+		if (!texture.id || isLoading(texture))
+		{
+			return;
 		}
 
-		return newLineCounter + 1;
+		queue(texture.id, fileName, pixelated, useMipMaps, std::move(callback));
 	}
 
-	void Renderer2D::renderText(glm::vec2 position, const char *text, const Font font,
-		const Color4f color, const float size, const float spacing, const float line_space, bool showInCenter,
-		const Color4f ShadowColor
-		, const Color4f LightColor
-	)
+	void AsyncTextureLoader::queue(GLuint texture, const char *fileName, bool pixelated, bool useMipMaps, Callback callback)
 	{
-		if (font.texture.id == 0)
+		Job *job = new Job;
+		job->fileName = fileName;
+		job->texture = texture;
+		job->generation = internal::getTextureGeneration(texture);
+		job->pixelated = pixelated;
+		job->useMipMaps = useMipMaps;
+		job->callback = std::move(callback);
+
+		//replaces a stale job of a deleted texture with the same id, it is dropped when it gets uploaded
+		loading[texture] = job;
+
 		{
-			errorFunc("Missing font", userDefinedData);
-			return;
+			std::lock_guard<std::mutex> lock(mutex);
+			requests.push_back(job);
 		}
+		wake.notify_one();
+	}
 
-		const int text_length = (int)strlen(text);
-		Rect rectangle;
-		rectangle.x = position.x;
-		float linePositionY = position.y;
+	void AsyncTextureLoader::workerLoop()
+	{
+		//the global flag is shared with the gl thread loads
+		stbi_set_flip_vertically_on_load_thread(true);
 
-		if (showInCenter)
+		for (;;)
 		{
-			//This is the y position we render at because it advances when we encounter newlines
+			Job *job = nullptr;
 
-			float maxPos = 0;
-			float maxPosY = 0;
-
-			for (int i = 0; i < text_length; i++)
 			{
-				if (text[i] == '\n')
-				{
-					rectangle.x = position.x;
-					linePositionY += (font.max_height + line_space) * size;
-				}
-				else if (text[i] == '\t')
-				{
-					const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-					(font, '_');
-					auto x = quad.x1 - quad.x0;
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&]() { return stopping || !requests.empty(); });
 
-					rectangle.x += x * size * 3 + spacing * size;
-				}
-				else if (text[i] == ' ')
+				if (stopping)
 				{
-					const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-					(font, '_');
-					auto x = quad.x1 - quad.x0;
-
-					rectangle.x += x * size + spacing * size;
+					return;
 				}
-				else if (text[i] >= ' ' && text[i] <= '~')
-				{
-					const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-					(font, text[i]);
-
-					rectangle.z = quad.x1 - quad.x0;
-					rectangle.w = quad.y1 - quad.y0;
 
-					rectangle.z *= size;
-					rectangle.w *= size;
-
-					rectangle.y = linePositionY + quad.y0 * size;
+				job = requests.front();
+				requests.pop_front();
+			}
 
+			internal::MappedFile file;
+			if (file.open(job->fileName.c_str()))
+			{
+				int channels = 0;
+				job->pixels = stbi_load_from_memory(file.data, (int)file.size, &job->size.x, &job->size.y, &channels, 4);
+			}
 
-					rectangle.x += rectangle.z + spacing * size;
-					maxPos = std::max(maxPos, rectangle.x);
-					maxPosY = std::max(maxPosY, rectangle.y);
-				}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				decoded.push_back(job);
 			}
+		}
+	}
 
-			float padd = maxPos - position.x;
-			padd /= 2;
-			position.x -= padd;
+	//the texture was deleted while it was loading, its id may belong to another texture now
+	bool AsyncTextureLoader::isStale(const Job *job)
+	{
+		return internal::getTextureGeneration(job->texture) != job->generation;
+	}
 
-			float paddY = maxPosY - position.y;
-			position.y -= paddY;
+	//frees a stale job without touching the texture or calling the callback
+	void AsyncTextureLoader::dropJob(Job *job)
+	{
+		auto found = loading.find(job->texture);
+		if (found != loading.end() && found->second == job)
+		{
+			loading.erase(found);
 		}
 
-		rectangle = {};
-		rectangle.x = position.x;
-
-		//This is the y position we render at because it advances when we encounter newlines
-		linePositionY = position.y;
+		STBI_FREE(job->pixels);
+		delete job;
+	}
 
-		for (int i = 0; i < text_length; i++)
+	void AsyncTextureLoader::finishJob(Job *job, bool succeeded)
+	{
+		if (isStale(job))
 		{
-			if (text[i] == '\n')
-			{
-				rectangle.x = position.x;
-				linePositionY += (font.max_height + line_space) * size;
-			}
-			else if (text[i] == '\t')
-			{
-				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-				(font, '_');
-				auto x = quad.x1 - quad.x0;
-
-				rectangle.x += x * size * 3 + spacing * size;
-			}
-			else if (text[i] == ' ')
-			{
-				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-				(font, '_');
-				auto x = quad.x1 - quad.x0;
-				rectangle.x += x * size + spacing * size;
-			}
-			else if (text[i] >= ' ' && text[i] <= '~')
-			{
+			dropJob(job);
+			return;
+		}
 
-				const stbtt_aligned_quad quad = internal::fontGetGlyphQuad
-				(font, text[i]);
+		loading.erase(job->texture);
 
-				rectangle.z = quad.x1 - quad.x0;
-				rectangle.w = quad.y1 - quad.y0;
+		if (!succeeded)
+		{
+			char c[300] = {0};
+			strcat(c, "error loading: ");
+			strncat(c + strlen(c), job->fileName.c_str(), 250);
+			errorFunc(c, userDefinedData);
+		}
 
-				rectangle.z *= size;
-				rectangle.w *= size;
+		if (job->callback)
+		{
+			Texture t;
+			t.id = job->texture;
+			job->callback(t, succeeded);
+		}
 
-				//rectangle.y = linePositionY - rectangle.w;
-				rectangle.y = linePositionY + quad.y0 * size;
+		STBI_FREE(job->pixels);
+		delete job;
+	}
 
-				glm::vec4 colorData[4] = {color, color, color, color};
+	void AsyncTextureLoader::update()
+	{
+		const auto start = std::chrono::steady_clock::now();
+		const auto budget = std::chrono::duration<float, std::milli>(uploadBudgetMs);
 
-				if (ShadowColor.w)
+		//at least one chunk is copied every frame so a zero budget still makes progress
+		do
+		{
+			if (!uploading)
+			{
 				{
-					glm::vec2 pos = {-5, 3};
-					pos *= size;
-					renderRectangle({rectangle.x + pos.x, rectangle.y + pos.y,  rectangle.z, rectangle.w},
-						font.texture, ShadowColor, glm::vec2{0, 0}, 0,
-						glm::vec4{quad.s0, quad.t0, quad.s1, quad.t1});
+					std::lock_guard<std::mutex> lock(mutex);
+					if (decoded.empty())
+					{
+						break;
+					}
 
+					uploading = decoded.front();
+					decoded.pop_front();
 				}
 
-				renderRectangle(rectangle, font.texture, colorData, glm::vec2{0, 0}, 0,
-					glm::vec4{quad.s0, quad.t0, quad.s1, quad.t1});
-
-				if (LightColor.w)
+				if (!uploading->pixels)
 				{
-					glm::vec2 pos = {-2, 1};
-					pos *= size;
-					renderRectangle({rectangle.x + pos.x, rectangle.y + pos.y,  rectangle.z, rectangle.w},
-						font.texture,
-						LightColor, glm::vec2{0, 0}, 0,
-						glm::vec4{quad.s0, quad.t0, quad.s1, quad.t1});
-
+					finishJob(uploading, false);
+					uploading = nullptr;
+					continue;
 				}
 
+				//the buffer stays mapped across frames until all the pixels are copied
+				const size_t bytes = (size_t)uploading->size.x * uploading->size.y * 4;
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+				glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+				uploadMemory = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+					GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			}
 
-				rectangle.x += rectangle.z + spacing * size;
+			auto &job = *uploading;
+			const size_t bytes = (size_t)job.size.x * job.size.y * 4;
+
+			if (uploadMemory)
+			{
+				const size_t chunk = std::min((size_t)GL2D_ASYNC_TEXTURE_UPLOAD_CHUNK, bytes - job.copiedBytes);
+				memcpy(uploadMemory + job.copiedBytes, job.pixels + job.copiedBytes, chunk);
+				job.copiedBytes += chunk;
+
+				if (job.copiedBytes < bytes)
+				{
+					continue;
+				}
 			}
-		}
-	}
 
-	void Renderer2D::renderTextWrapped(const std::string &text,
-		gl2d::Font f, glm::vec4 textPos, glm::vec4 color, float baseSize,
-		float spacing, float lineSpacing,
-		bool showInCenter, glm::vec4 shadowColor, glm::vec4 lightColor)
-	{
-		std::string newText;
-		wrap(text, f, baseSize, textPos.z, &newText);
-		renderText(textPos,
-			newText.c_str(), f, color, baseSize, spacing, lineSpacing, showInCenter,
-			shadowColor, lightColor);
-	}
+			if (isStale(uploading))
+			{
+				if (uploadMemory)
+				{
+					glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+					glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+					glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+					uploadMemory = nullptr;
+				}
 
-	glm::vec2 Renderer2D::getTextSizeWrapped(const std::string &text,
-		gl2d::Font f, float maxTextLenght, float baseSize, float spacing, float lineSpacing)
-	{
-		std::string newText;
-		wrap(text, f, baseSize, maxTextLenght, &newText);
-		auto rez = getTextSize(
-			newText.c_str(), f, baseSize, spacing, lineSpacing);
+				dropJob(uploading);
+				uploading = nullptr;
+				continue;
+			}
 
-		return rez;
-	}
+			//the texture is replaced in one go so it never shows a partial image
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, job.texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000); //eviction limits it to the 1x1 level
 
-	void Renderer2D::clearScreen(const Color4f color)
-	{
-		glBindFramebuffer(GL_FRAMEBUFFER, defaultFBO);
-	
-		#if GL2D_USE_OPENGL_130
-			GLfloat oldColor[4];
-			glGetFloatv(GL_COLOR_CLEAR_VALUE, oldColor);
+			if (uploadMemory)
+			{
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+				uploadMemory = nullptr;
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, job.size.x, job.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			}
+			else
+			{
+				//mapping failed, upload from client memory
+				glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, job.size.x, job.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, job.pixels);
+			}
 
-			glClearColor(color.r, color.g, color.b, color.a);
-			glClear(GL_COLOR_BUFFER_BIT);
-			glClearColor(oldColor[0], oldColor[1], oldColor[2], oldColor[3]);
-		#else
-			glClearBufferfv(GL_COLOR, 0, &color[0]);
-		#endif
+			if (job.useMipMaps)
+			{
+				glGenerateMipmap(GL_TEXTURE_2D);
+			}
+			glBindTexture(GL_TEXTURE_2D, 0);
 
-	}
+			internal::registerTexture(job.texture, job.size, GL_RGBA8, job.useMipMaps);
 
-	void Renderer2D::setShaderProgram(const ShaderProgram shader)
-	{
-		currentShader = shader;
-	}
+			finishJob(uploading, true);
+			uploading = nullptr;
 
-	void Renderer2D::setCamera(const Camera camera)
-	{
-		currentCamera = camera;
+		} while (std::chrono::steady_clock::now() - start < budget);
 	}
 
-	void Renderer2D::resetCameraAndShader()
+	bool AsyncTextureLoader::isLoading(Texture texture)
 	{
-		currentCamera = defaultCamera;
-		currentShader = defaultShader;
+		auto found = loading.find(texture.id);
+		return found != loading.end() && !isStale(found->second);
 	}
 
 #pragma endregion
 
-	glm::ivec2 Texture::GetSize()
-	{
-		glm::ivec2 s;
-		glBindTexture(GL_TEXTURE_2D, id);
-		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &s.x);
-		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &s.y);
-		return s;
-	}
+	//glm::mat3 Camera::getMatrix()
+	//{
+	//	glm::mat3 m;
+	//	m = { zoom, 0, position.x ,
+	//		 0, zoom, position.y,
+	//		0, 0, 1,
+	//	};
+	//	m = glm::transpose(m);
+	//	return m; //todo not tested, add rotation
+	//}
 
-	void Texture::createFromBuffer(const char* image_data, const int width, const int height
-		,bool pixelated, bool useMipMaps)
+	void Camera::follow(glm::vec2 pos, float speed, float min, float max, float w, float h)
 	{
-		GLuint id = 0;
+		pos.x -= w / 2.f;
+		pos.y -= h / 2.f;
 
-		glActiveTexture(GL_TEXTURE0);
+		glm::vec2 delta = pos - position;
+		bool signX = delta.x >= 0;
+		bool signY = delta.y >= 0;
 
-		glGenTextures(1, &id);
-		glBindTexture(GL_TEXTURE_2D, id);
+		float len = glm::length(delta);
 
-		if (pixelated)
+		delta = glm::normalize(delta);
+
+		if (len < min * 2)
 		{
-			if (useMipMaps)
-			{
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
-			}
-			else 
-			{
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-			}
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			speed /= 4.f;
 		}
-		else 
+		else if (len < min * 4)
 		{
-			if (useMipMaps)
+			speed /= 2.f;
+		}
+
+		if (len > min)
+		{
+			if (len > max)
 			{
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+				len = max;
+				position = pos - (max * delta);
+				position += delta * speed;
 			}
 			else
 			{
-				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+				position += delta * speed;
+
+
+			}
+
+			glm::vec2 delta2 = pos - position;
+			bool signX2 = delta.x >= 0;
+			bool signY2 = delta.y >= 0;
+			if (signX2 != signX || signY2 != signY || glm::length(delta2) > len)
+			{
+				position = pos;
 			}
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		}
+	}
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glm::vec2 internal::convertPoint(const Camera &camera, const glm::vec2& p, float windowW, float windowH)
+	{
+		glm::vec2 r = p;
 
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image_data);
-		glGenerateMipmap(GL_TEXTURE_2D);
 
+		//Apply camera transformations
+		r.x += camera.position.x;
+		r.y += camera.position.y;
 
-		this->id = id;
-	}
+		{
+			glm::vec2 cameraCenter = { camera.position.x + windowW / 2, -camera.position.y - windowH / 2 };
+
+			r = rotateAroundPoint(r,
+				cameraCenter,
+				camera.rotation);
+		}
 
-	void Texture::create1PxSquare(const char* b)
-	{
-		if (b == nullptr)
 		{
-			const unsigned char buff[] =
-			{
-				0xff,
-				0xff,
-				0xff,
-				0xff
-			};
+			glm::vec2 cameraCenter = { camera.position.x + windowW / 2, camera.position.y + windowH / 2 };
+
+			r = scaleAroundPoint(r,
+				cameraCenter,
+				1.f / camera.zoom);
+		}
+
+		//if (this->rotation != 0)
+		//{
+		//	glm::vec2 cameraCenter;
+		//
+		//	cameraCenter.x = windowW / 2.0f;
+		//	cameraCenter.y = windowH / 2.0f;
+		//
+		//	r = rotateAroundPoint(r, cameraCenter, this->rotation);
+		//
+		//}
+
+		//{
+		//	glm::vec2 cameraCenter;
+		//	cameraCenter.x = windowW / 2.0f;
+		//	cameraCenter.y = -windowH / 2.0f;
+		//
+		//	r = scaleAroundPoint(r, cameraCenter, this->zoom);
+		//
+		//}
 
-			createFromBuffer((char*)buff, 1, 1);
-		}
-		else
+		return r;
+	}
+
+	//the format and type of the texture storage for a render target internal format
+	static void renderTargetPixelFormat(GLenum internalFormat, GLenum &format, GLenum &type)
+	{
+		switch (internalFormat)
 		{
-			createFromBuffer(b, 1, 1);
+			case GL_R8: format = GL_RED; type = GL_UNSIGNED_BYTE; break;
+			case GL_RGBA16F: format = GL_RGBA; type = GL_HALF_FLOAT; break;
+			default: format = GL_RGBA; type = GL_UNSIGNED_BYTE; break;
 		}
-
 	}
 
-	void Texture::createFromFileData(const unsigned char* image_file_data, const size_t image_file_size
-		,bool pixelated, bool useMipMaps)
+	void FrameBuffer::create(unsigned int w, unsigned int h, bool useDepth, GLenum internalFormat)
 	{
-		stbi_set_flip_vertically_on_load(true);
-
-		int width = 0;
-		int height = 0;
-		int channels = 0;
+		this->internalFormat = internalFormat;
 
-		const unsigned char* decodedImage = stbi_load_from_memory(image_file_data, (int)image_file_size, &width, &height, &channels, 4);
+		GLenum format = 0;
+		GLenum type = 0;
+		renderTargetPixelFormat(internalFormat, format, type);
 
-		createFromBuffer((const char*)decodedImage, width, height, pixelated, useMipMaps);
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
 
-		STBI_FREE(decodedImage);
-	}
+		glGenTextures(1, &texture.id);
+		glBindTexture(GL_TEXTURE_2D, texture.id);
 
-	void Texture::createFromFileDataWithPixelPadding(const unsigned char* image_file_data, const size_t image_file_size, int blockSize,
-		bool pixelated, bool useMipMaps)
-	{
-		stbi_set_flip_vertically_on_load(true);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, format, type, NULL);
+		internal::registerTexture(texture.id, {(int)w, (int)h}, internalFormat, false);
 
-		int width = 0;
-		int height = 0;
-		int channels = 0;
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.id, 0);
 
-		const unsigned char* decodedImage = stbi_load_from_memory(image_file_data, (int)image_file_size, &width, &height, &channels, 4);
+		//glDrawBuffer(GL_COLOR_ATTACHMENT0); //todo why is this commented out ?
 
-		int newW = width + ((width * 2) / blockSize);
-		int newH = height + ((height * 2) / blockSize);
+		//glGenTextures(1, &depthtTexture);
+		//glBindTexture(GL_TEXTURE_2D, depthtTexture);
 
-		auto getOld = [decodedImage, width](int x, int y, int c)->const unsigned char
-		{
-			return decodedImage[4 * (x + (y * width)) + c];
-		};
+		//glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32, w, h, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, NULL);
 
+		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-		unsigned char* newData = new unsigned char[newW * newH * 4]{};
+		//glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthtTexture, 0);
 
-		auto getNew = [newData, newW](int x, int y, int c)
+		if (useDepth)
 		{
-			return &newData[4 * (x + (y * newW)) + c];
-		};
-
-		int newDataCursor = 0;
-		int dataCursor = 0;
+			glGenRenderbuffers(1, &depthBuffer);
+			glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+			glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		}
 
-		//first copy data
-		for (int y = 0; y < newH; y++)
-		{
-			int yNo = 0;
-			if ((y == 0 || y == newH - 1
-				|| ((y) % (blockSize + 2)) == 0 ||
-				((y + 1) % (blockSize + 2)) == 0
-				))
-			{
-				yNo = 1;
-			}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-			for (int x = 0; x < newW; x++)
-			{
-				if (
-					yNo ||
+	}
 
-					((
-						x == 0 || x == newW - 1
-						|| (x % (blockSize + 2)) == 0 ||
-						((x + 1) % (blockSize + 2)) == 0
-						)
-						)
+	void FrameBuffer::resize(unsigned int w, unsigned int h)
+	{
+		GLenum format = 0;
+		GLenum type = 0;
+		renderTargetPixelFormat(internalFormat, format, type);
 
-					)
-				{
-					newData[newDataCursor++] = 0;
-					newData[newDataCursor++] = 0;
-					newData[newDataCursor++] = 0;
-					newData[newDataCursor++] = 0;
-				}
-				else
-				{
-					newData[newDataCursor++] = decodedImage[dataCursor++];
-					newData[newDataCursor++] = decodedImage[dataCursor++];
-					newData[newDataCursor++] = decodedImage[dataCursor++];
-					newData[newDataCursor++] = decodedImage[dataCursor++];
-				}
+		glBindTexture(GL_TEXTURE_2D, texture.id);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, format, type, NULL);
+		internal::registerTexture(texture.id, {(int)w, (int)h}, internalFormat, false);
 
-			}
+		//glBindTexture(GL_TEXTURE_2D, depthtTexture);
+		//glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
 
+		if (depthBuffer)
+		{
+			glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+			glBindRenderbuffer(GL_RENDERBUFFER, 0);
 		}
 
-		//then add margins
-
+	}
 
-		for (int x = 1; x < newW - 1; x++)
+	void FrameBuffer::cleanup()
+	{
+		if (fbo)
 		{
-			//copy on left
-			if (x == 1 ||
-				(x % (blockSize + 2)) == 1
-				)
-			{
-				for (int y = 0; y < newH; y++)
-				{
-					*getNew(x - 1, y, 0) = *getNew(x, y, 0);
-					*getNew(x - 1, y, 1) = *getNew(x, y, 1);
-					*getNew(x - 1, y, 2) = *getNew(x, y, 2);
-					*getNew(x - 1, y, 3) = *getNew(x, y, 3);
-				}
-
-			}
-			else //copy on rigght
-				if (x == newW - 2 ||
-					(x % (blockSize + 2)) == blockSize
-					)
-				{
-					for (int y = 0; y < newH; y++)
-					{
-						*getNew(x + 1, y, 0) = *getNew(x, y, 0);
-						*getNew(x + 1, y, 1) = *getNew(x, y, 1);
-						*getNew(x + 1, y, 2) = *getNew(x, y, 2);
-						*getNew(x + 1, y, 3) = *getNew(x, y, 3);
-					}
-				}
+			glDeleteFramebuffers(1, &fbo);
+			fbo = 0;
 		}
 
-		for (int y = 1; y < newH - 1; y++)
+		if (texture.id)
 		{
-			if (y == 1 ||
-				(y % (blockSize + 2)) == 1
-				)
-			{
-				for (int x = 0; x < newW; x++)
-				{
-					*getNew(x, y - 1, 0) = *getNew(x, y, 0);
-					*getNew(x, y - 1, 1) = *getNew(x, y, 1);
-					*getNew(x, y - 1, 2) = *getNew(x, y, 2);
-					*getNew(x, y - 1, 3) = *getNew(x, y, 3);
-				}
-			}
-			else
-				if (y == newH - 2 ||
-					(y % (blockSize + 2)) == blockSize
-					)
-				{
-					for (int x = 0; x < newW; x++)
-					{
-						*getNew(x, y + 1, 0) = *getNew(x, y, 0);
-						*getNew(x, y + 1, 1) = *getNew(x, y, 1);
-						*getNew(x, y + 1, 2) = *getNew(x, y, 2);
-						*getNew(x, y + 1, 3) = *getNew(x, y, 3);
-					}
-				}
+			texture.cleanup();
+		}
 
+		if (depthBuffer)
+		{
+			glDeleteRenderbuffers(1, &depthBuffer);
+			depthBuffer = 0;
 		}
+	}
 
-		createFromBuffer((const char*)newData, newW, newH, pixelated, useMipMaps);
+	void FrameBuffer::clear()
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		//glClearColor(1, 1, 1, 0);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		//glClearColor(0, 0, 0, 0);
 
-		STBI_FREE(decodedImage);
-		delete[] newData;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
 
-	void Texture::loadFromFile(const char* fileName, bool pixelated, bool useMipMaps)
+	FrameBuffer RenderTargetPool::acquire(glm::ivec2 size, GLenum internalFormat, bool useDepth)
 	{
-		std::ifstream file(fileName, std::ios::binary);
+		size = glm::max(size, glm::ivec2(1));
 
-		if (!file.is_open())
+		for (auto &t : targets)
 		{
-			char c[300] = { 0 };
-			strcat(c, "error openning: ");
-			strcat(c + strlen(c), fileName);
-			errorFunc(c, userDefinedData);
-			return;
+			if (!t.inUse && t.size == size && t.frameBuffer.internalFormat == internalFormat && t.useDepth == useDepth)
+			{
+				t.inUse = true;
+				t.unusedFrames = 0;
+				return t.frameBuffer;
+			}
 		}
 
-		int fileSize = 0;
-		file.seekg(0, std::ios::end);
-		fileSize = (int)file.tellg();
-		file.seekg(0, std::ios::beg);
-		unsigned char* fileData = new unsigned char[fileSize];
-		file.read((char*)fileData, fileSize);
-		file.close();
-
-		createFromFileData(fileData, fileSize, pixelated, useMipMaps);
-
-		delete[] fileData;
+		Target t;
+		t.frameBuffer.create(size.x, size.y, useDepth, internalFormat);
+		t.size = size;
+		t.useDepth = useDepth;
+		t.inUse = true;
+		targets.push_back(t);
 
+		return t.frameBuffer;
 	}
 
-	void Texture::loadFromFileWithPixelPadding(const char* fileName, int blockSize,
-		bool pixelated, bool useMipMaps)
+	void RenderTargetPool::release(FrameBuffer frameBuffer)
 	{
-		std::ifstream file(fileName, std::ios::binary);
-
-		if (!file.is_open())
+		for (auto &t : targets)
 		{
-			char c[300] = { 0 };
-			strcat(c, "error openning: ");
-			strcat(c + strlen(c), fileName);
-			errorFunc(c, userDefinedData);
-			return;
+			if (t.frameBuffer.fbo == frameBuffer.fbo)
+			{
+				t.inUse = false;
+				return;
+			}
 		}
-
-		int fileSize = 0;
-		file.seekg(0, std::ios::end);
-		fileSize = (int)file.tellg();
-		file.seekg(0, std::ios::beg);
-		unsigned char* fileData = new unsigned char[fileSize];
-		file.read((char*)fileData, fileSize);
-		file.close();
-
-		createFromFileDataWithPixelPadding(fileData, fileSize, blockSize, pixelated, useMipMaps);
-
-		delete[] fileData;
-
 	}
 
-	void Texture::bind(const unsigned int sample)
+	void RenderTargetPool::endFrame()
 	{
-		glActiveTexture(GL_TEXTURE0 + sample);
-		glBindTexture(GL_TEXTURE_2D, id);
-	}
+		for (int i = 0; i < (int)targets.size();)
+		{
+			auto &t = targets[i];
 
-	void Texture::unbind()
-	{
-		glBindTexture(GL_TEXTURE_2D, 0);
-	}
+			if (t.inUse)
+			{
+				t.inUse = false;
+				t.unusedFrames = 0;
+			}
+			else if (++t.unusedFrames > maxUnusedFrames)
+			{
+				t.frameBuffer.cleanup();
+				targets[i] = targets.back();
+				targets.pop_back();
+				continue;
+			}
 
-	void Texture::cleanup()
-	{
-		glDeleteTextures(1, &id);
+			i++;
+		}
 	}
 
-	//glm::mat3 Camera::getMatrix()
-	//{
-	//	glm::mat3 m;
-	//	m = { zoom, 0, position.x ,
-	//		 0, zoom, position.y,
-	//		0, 0, 1,
-	//	};
-	//	m = glm::transpose(m);
-	//	return m; //todo not tested, add rotation
-	//}
-
-	void Camera::follow(glm::vec2 pos, float speed, float min, float max, float w, float h)
+	void RenderTargetPool::cleanup()
 	{
-		pos.x -= w / 2.f;
-		pos.y -= h / 2.f;
+		for (auto &t : targets)
+		{
+			t.frameBuffer.cleanup();
+		}
 
-		glm::vec2 delta = pos - position;
-		bool signX = delta.x >= 0;
-		bool signY = delta.y >= 0;
+		targets.clear();
+	}
 
-		float len = glm::length(delta);
+	ShaderProgram createPostProcessShader(const char *fragment)
+	{
+		return createShaderProgram(postProcessVertexShader, fragment);
+	}
 
-		delta = glm::normalize(delta);
+	void PostProcessChain::addPass(ShaderProgram shader, float resolutionScale, GLenum format)
+	{
+		PostProcessPass pass;
+		pass.shader = shader;
+		pass.resolutionScale = resolutionScale;
+		pass.format = format;
+		passes.push_back(std::move(pass));
+	}
 
-		if (len < min * 2)
-		{
-			speed /= 4.f;
-		}
-		else if (len < min * 4)
+	void PostProcessChain::render(Renderer2D &renderer, Texture input)
+	{
+		if (passes.empty() || renderer.windowW <= 0 || renderer.windowH <= 0)
 		{
-			speed /= 2.f;
+			return;
 		}
 
-		if (len > min)
+		const glm::ivec2 windowSize = {renderer.windowW, renderer.windowH};
+
+		Texture source = input;
+		glm::ivec2 sourceSize = input.GetSize();
+		FrameBuffer previous = {};
+
+		glDisable(GL_DEPTH_TEST);
+		glBindVertexArray(fullScreenVao);
+
+		for (int i = 0; i < (int)passes.size(); i++)
 		{
-			if (len > max)
+			auto &pass = passes[i];
+			const bool last = i == (int)passes.size() - 1;
+
+			FrameBuffer target = {};
+			glm::ivec2 size = windowSize;
+
+			if (last)
 			{
-				len = max;
-				position = pos - (max * delta);
-				position += delta * speed;
+				glBindFramebuffer(GL_FRAMEBUFFER, renderer.defaultFBO);
+
+				if (blendOutput) { enableNecessaryGLFeatures(); }
+				else { glDisable(GL_BLEND); }
 			}
 			else
 			{
-				position += delta * speed;
+				size = glm::max(glm::ivec2(glm::vec2(windowSize) * pass.resolutionScale), glm::ivec2(1));
+				target = renderer.renderTargets.acquire(size, pass.format);
+
+				//every pixel is written, no clear needed
+				glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+				glDisable(GL_BLEND);
+			}
+
+			glViewport(0, 0, size.x, size.y);
 
+			glUseProgram(pass.shader.id);
+			glUniform1i(pass.shader.u_sampler, 0);
 
+			const GLint texelSize = glGetUniformLocation(pass.shader.id, "u_texelSize");
+			if (texelSize >= 0)
+			{
+				glUniform2f(texelSize, 1.f / std::max(sourceSize.x, 1), 1.f / std::max(sourceSize.y, 1));
 			}
 
-			glm::vec2 delta2 = pos - position;
-			bool signX2 = delta.x >= 0;
-			bool signY2 = delta.y >= 0;
-			if (signX2 != signX || signY2 != signY || glm::length(delta2) > len)
+			for (int j = 0; j < (int)pass.inputs.size(); j++)
 			{
-				position = pos;
+				glUniform1i(glGetUniformLocation(pass.shader.id, pass.inputs[j].first.c_str()), j + 1);
+				pass.inputs[j].second.bind(j + 1);
 			}
-		}
-	}
 
-	glm::vec2 internal::convertPoint(const Camera &camera, const glm::vec2& p, float windowW, float windowH)
-	{
-		glm::vec2 r = p;
+			if (pass.setUniforms)
+			{
+				pass.setUniforms(pass.shader.id);
+			}
 
+			source.bind(0);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
 
-		//Apply camera transformations
-		r.x += camera.position.x;
-		r.y += camera.position.y;
+			for (int j = 0; j < (int)pass.inputs.size(); j++)
+			{
+				glActiveTexture(GL_TEXTURE0 + j + 1);
+				glBindTexture(GL_TEXTURE_2D, 0);
+			}
+			glActiveTexture(GL_TEXTURE0);
 
-		{
-			glm::vec2 cameraCenter = { camera.position.x + windowW / 2, -camera.position.y - windowH / 2 };
+			if (previous.fbo)
+			{
+				renderer.renderTargets.release(previous);
+			}
 
-			r = rotateAroundPoint(r,
-				cameraCenter,
-				camera.rotation);
+			previous = target;
+			source = target.texture;
+			sourceSize = size;
 		}
 
-		{
-			glm::vec2 cameraCenter = { camera.position.x + windowW / 2, camera.position.y + windowH / 2 };
+		glBindVertexArray(0);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glViewport(0, 0, windowSize.x, windowSize.y);
 
-			r = scaleAroundPoint(r,
-				cameraCenter,
-				1.f / camera.zoom);
-		}
+		enableNecessaryGLFeatures();
+	}
 
-		//if (this->rotation != 0)
-		//{
-		//	glm::vec2 cameraCenter;
-		//
-		//	cameraCenter.x = windowW / 2.0f;
-		//	cameraCenter.y = windowH / 2.0f;
-		//
-		//	r = rotateAroundPoint(r, cameraCenter, this->rotation);
-		//
-		//}
+	size_t RenderTargetPool::getMemoryUsage()
+	{
+		size_t bytes = 0;
 
-		//{
-		//	glm::vec2 cameraCenter;
-		//	cameraCenter.x = windowW / 2.0f;
-		//	cameraCenter.y = -windowH / 2.0f;
-		//
-		//	r = scaleAroundPoint(r, cameraCenter, this->zoom);
-		//
-		//}
+		for (auto &t : targets)
+		{
+			if (auto info = getTextureInfo(t.frameBuffer.texture.id))
+			{
+				bytes += info->bytes;
+			}
+		}
 
-		return r;
+		return bytes;
 	}
 
-	void FrameBuffer::create(unsigned int w, unsigned int h)
+
+	const std::vector<Rect> &DamageTracker::computeDamage(int windowW, int windowH, float padding, float maxCoverage)
 	{
-		glGenFramebuffers(1, &fbo);
-		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		damage.clear();
 
-		glGenTextures(1, &texture.id);
-		glBindTexture(GL_TEXTURE_2D, texture.id);
+		const Rect window = {0, 0, windowW, windowH};
 
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		if (fullRedraw)
+		{
+			damage.push_back(window);
+			return damage;
+		}
 
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.id, 0);
+		auto addRect = [&](Rect r)
+		{
+			//to min max and clamp to the window
+			glm::vec4 m = {r.x - padding, r.y - padding, r.x + r.z + padding, r.y + r.w + padding};
+			m.x = std::max(m.x, 0.f);
+			m.y = std::max(m.y, 0.f);
+			m.z = std::min(m.z, (float)windowW);
+			m.w = std::min(m.w, (float)windowH);
 
-		//glDrawBuffer(GL_COLOR_ATTACHMENT0); //todo why is this commented out ?
+			//snapped out to whole pixels so a scissor and a clip rect made from it cover the same pixels
+			m = {std::floor(m.x), std::floor(m.y), std::ceil(m.z), std::ceil(m.w)};
 
-		//glGenTextures(1, &depthtTexture);
-		//glBindTexture(GL_TEXTURE_2D, depthtTexture);
+			if (m.z > m.x && m.w > m.y)
+			{
+				damage.push_back(m);
+			}
+		};
 
-		//glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT32, w, h, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, NULL);
+		for (auto &r : previousBounds) { addRect(r); }
+		for (auto &r : currentBounds) { addRect(r); }
 
-		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		//glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		//merge overlapping rects until none overlap
+		bool merged = true;
+		while (merged)
+		{
+			merged = false;
 
-		//glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthtTexture, 0);
+			for (int i = 0; i < (int)damage.size() && !merged; i++)
+			{
+				for (int j = i + 1; j < (int)damage.size(); j++)
+				{
+					glm::vec4 &a = damage[i];
+					glm::vec4 &b = damage[j];
 
-		glBindTexture(GL_TEXTURE_2D, 0);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+					if (a.x < b.z && b.x < a.z && a.y < b.w && b.y < a.w)
+					{
+						a = {std::min(a.x, b.x), std::min(a.y, b.y), std::max(a.z, b.z), std::max(a.w, b.w)};
+						damage[j] = damage.back();
+						damage.pop_back();
+						merged = true;
+						break;
+					}
+				}
+			}
+		}
 
-	}
+		float area = 0;
+		for (auto &m : damage)
+		{
+			area += (m.z - m.x) * (m.w - m.y);
 
-	void FrameBuffer::resize(unsigned int w, unsigned int h)
-	{
-		glBindTexture(GL_TEXTURE_2D, texture.id);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+			//back to x y w h
+			m.z -= m.x;
+			m.w -= m.y;
+		}
 
-		//glBindTexture(GL_TEXTURE_2D, depthtTexture);
-		//glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		if (area > maxCoverage * windowW * windowH)
+		{
+			damage.clear();
+			damage.push_back(window);
+		}
 
+		return damage;
 	}
 
-	void FrameBuffer::cleanup()
+	Rect DamageTracker::getDamageBounds()
 	{
-		if (fbo)
-		{
-			glDeleteFramebuffers(1, &fbo);
-			fbo = 0;
-		}
+		if (damage.empty()) { return {}; }
 
-		if (texture.id)
+		glm::vec4 m = {damage[0].x, damage[0].y, damage[0].x + damage[0].z, damage[0].y + damage[0].w};
+
+		for (auto &r : damage)
 		{
-			glDeleteTextures(1, &texture.id);
-			texture = {};
+			m.x = std::min(m.x, r.x);
+			m.y = std::min(m.y, r.y);
+			m.z = std::max(m.z, r.x + r.z);
+			m.w = std::max(m.w, r.y + r.w);
 		}
 
-		//glDeleteTextures(1, &depthtTexture);
-		//depthtTexture = 0;
+		return {m.x, m.y, m.z - m.x, m.w - m.y};
 	}
 
-	void FrameBuffer::clear()
+	void DamageTracker::endFrame()
 	{
-		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-		//glClearColor(1, 1, 1, 0);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		//glClearColor(0, 0, 0, 0);
-
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		std::swap(previousBounds, currentBounds);
+		currentBounds.clear();
+		fullRedraw = false;
 	}
 
-
 	glm::vec4 computeTextureAtlas(int xCount, int yCount, int x, int y, bool flip)
 	{
 		float xSize = 1.f / xCount;
@@ -2272,6 +5438,235 @@ namespace gl2d
 		}
 	}
 
+	///////////////////// RuntimeAtlas /////////////////////
+#pragma region RuntimeAtlas
+
+	void RuntimeAtlas::create(int pageSize, int padding, bool pixelated, bool useMipMaps)
+	{
+		cleanup();
+
+		this->pageSize = std::max(pageSize, 1);
+		this->padding = std::max(padding, 0);
+		this->pixelated = pixelated;
+		this->useMipMaps = useMipMaps;
+	}
+
+	void RuntimeAtlas::cleanup()
+	{
+		for (auto &p : pages)
+		{
+			p.texture.cleanup();
+		}
+
+		pages.clear();
+	}
+
+	int RuntimeAtlas::findPosition(const Page &page, glm::ivec2 size, glm::ivec2 &position)
+	{
+		int best = -1;
+		int bestY = pageSize;
+		int bestWidth = pageSize + 1;
+
+		for (int i = 0; i < (int)page.skyline.size(); i++)
+		{
+			const int x = page.skyline[i].x;
+			if (x + size.x > pageSize)
+			{
+				break;
+			}
+
+			//the rect rests on the highest segment under it
+			int y = 0;
+			for (int j = i, left = size.x; left > 0; j++)
+			{
+				y = std::max(y, page.skyline[j].y);
+				left -= page.skyline[j].z;
+			}
+
+			if (y + size.y > pageSize)
+			{
+				continue;
+			}
+
+			//bottom left, ties go to the narrower segment
+			if (y < bestY || (y == bestY && page.skyline[i].z < bestWidth))
+			{
+				best = i;
+				bestY = y;
+				bestWidth = page.skyline[i].z;
+				position = {x, y};
+			}
+		}
+
+		return best;
+	}
+
+	void RuntimeAtlas::insert(Page &page, int segment, glm::ivec2 position, glm::ivec2 size)
+	{
+		auto &skyline = page.skyline;
+		skyline.insert(skyline.begin() + segment, {position.x, position.y + size.y, size.x});
+
+		//cut the segments that are now under the rect
+		const int right = position.x + size.x;
+		for (int i = segment + 1; i < (int)skyline.size();)
+		{
+			auto &s = skyline[i];
+			if (s.x >= right)
+			{
+				break;
+			}
+
+			const int shrink = right - s.x;
+			if (shrink >= s.z)
+			{
+				skyline.erase(skyline.begin() + i);
+				continue;
+			}
+
+			s.x += shrink;
+			s.z -= shrink;
+			break;
+		}
+
+		for (int i = 0; i + 1 < (int)skyline.size();)
+		{
+			if (skyline[i].y == skyline[i + 1].y)
+			{
+				skyline[i].z += skyline[i + 1].z;
+				skyline.erase(skyline.begin() + i + 1);
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	//the gaps between the sprites are sampled by the mips and the filtering, they must be transparent.
+	//Cleared through a framebuffer on the gpu, no page sized buffer is needed.
+	static void clearAtlasPage(Texture texture)
+	{
+		GLint lastFramebuffer = 0;
+		GLfloat lastClearColor[4] = {};
+		glGetIntegerv(GL_FRAMEBUFFER_BINDING, &lastFramebuffer);
+		glGetFloatv(GL_COLOR_CLEAR_VALUE, lastClearColor);
+
+		GLuint fbo = 0;
+		glGenFramebuffers(1, &fbo);
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.id, 0);
+
+		glClearColor(0, 0, 0, 0);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, lastFramebuffer);
+		glDeleteFramebuffers(1, &fbo);
+		glClearColor(lastClearColor[0], lastClearColor[1], lastClearColor[2], lastClearColor[3]);
+	}
+
+	AtlasSprite RuntimeAtlas::add(const unsigned char *rgba, int width, int height)
+	{
+		const glm::ivec2 padded = {width + padding * 2, height + padding * 2};
+
+		if (!rgba || width <= 0 || height <= 0 || padded.x > pageSize || padded.y > pageSize)
+		{
+			errorFunc("Image doesn't fit in the RuntimeAtlas pages", userDefinedData);
+			return {};
+		}
+
+		glm::ivec2 position = {};
+		int page = 0;
+		int segment = -1;
+
+		for (; page < (int)pages.size(); page++)
+		{
+			segment = findPosition(pages[page], padded, position);
+			if (segment >= 0) { break; }
+		}
+
+		if (segment < 0)
+		{
+			Page p;
+			p.texture.createFromBuffer(nullptr, pageSize, pageSize, pixelated, useMipMaps);
+			clearAtlasPage(p.texture);
+			p.skyline.push_back({0, 0, pageSize});
+			pages.push_back(std::move(p));
+
+			page = (int)pages.size() - 1;
+			segment = findPosition(pages[page], padded, position);
+		}
+
+		insert(pages[page], segment, position, padded);
+
+		//copy the image and clamp the coordinates for the padding, this extrudes the edges
+		std::vector<unsigned char> pixels((size_t)padded.x * padded.y * 4);
+		for (int y = 0; y < padded.y; y++)
+		{
+			const int sy = glm::clamp(y - padding, 0, height - 1);
+			for (int x = 0; x < padded.x; x++)
+			{
+				const int sx = glm::clamp(x - padding, 0, width - 1);
+				memcpy(&pixels[((size_t)y * padded.x + x) * 4], &rgba[((size_t)sy * width + sx) * 4], 4);
+			}
+		}
+
+		glBindTexture(GL_TEXTURE_2D, pages[page].texture.id);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, position.x, position.y, padded.x, padded.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		if (useMipMaps)
+		{
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		const glm::vec2 p0 = glm::vec2(position + padding) / (float)pageSize;
+		const glm::vec2 p1 = glm::vec2(position + padding + glm::ivec2(width, height)) / (float)pageSize;
+
+		AtlasSprite sprite;
+		sprite.texture = pages[page].texture;
+		sprite.uv = {p0.x, p1.y, p1.x, p0.y};
+		sprite.size = {width, height};
+		return sprite;
+	}
+
+	AtlasSprite RuntimeAtlas::addFromFileData(const unsigned char *image_file_data, const size_t image_file_size)
+	{
+		stbi_set_flip_vertically_on_load(true);
+
+		int width = 0;
+		int height = 0;
+		int channels = 0;
+
+		unsigned char *decodedImage = stbi_load_from_memory(image_file_data, (int)image_file_size, &width, &height, &channels, 4);
+		if (!decodedImage)
+		{
+			errorFunc("error decoding the image to add to the RuntimeAtlas", userDefinedData);
+			return {};
+		}
+
+		AtlasSprite sprite = add(decodedImage, width, height);
+
+		STBI_FREE(decodedImage);
+		return sprite;
+	}
+
+	AtlasSprite RuntimeAtlas::addFromFile(const char *fileName)
+	{
+		internal::MappedFile file;
+
+		if (!file.open(fileName))
+		{
+			char c[300] = {0};
+			strcat(c, "error openning: ");
+			strncat(c + strlen(c), fileName, 250);
+			errorFunc(c, userDefinedData);
+			return {};
+		}
+
+		return addFromFileData(file.data, file.size);
+	}
+
+#pragma endregion
+
 	
 
 
@@ -0,0 +1,337 @@
+#include <gl2d/gl2dLightSystem.h>
+#include <algorithm>
+#include <cmath>
+
+namespace gl2d
+{
+
+	static GLuint lightShader = 0;
+	static GLint lightShaderTileSize = -1;
+	static GLint lightShaderTilesX = -1;
+	static GLint lightShaderAmbient = -1;
+
+	static GLuint lightCompositeShader = 0;
+
+	//one triangle that covers the screen, generated from gl_VertexID so no vertex buffer is needed
+	static const char *fullScreenVertexShader =
+		GL2D_OPNEGL_SHADER_VERSION "\n"
+		GL2D_OPNEGL_SHADER_PRECISION "\n"
+		R"(out vec2 v_texture;
+		void main()
+		{
+			vec2 p = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+			v_texture = p;
+			gl_Position = vec4(p * 2.0 - 1.0, 0, 1);
+		})";
+
+	//the output is halved so the composite pass (dst * src * 2) can brighten the scene
+	static const char *lightFragmentShader =
+		GL2D_OPNEGL_SHADER_VERSION "\n"
+		GL2D_OPNEGL_SHADER_PRECISION "\n"
+		R"(out vec4 color;
+		uniform samplerBuffer u_lights;
+		uniform isamplerBuffer u_tiles;
+		uniform isamplerBuffer u_indices;
+		uniform int u_tileSize;
+		uniform int u_tilesX;
+		uniform vec3 u_ambient;
+		void main()
+		{
+			ivec2 tile = ivec2(gl_FragCoord.xy) / u_tileSize;
+			ivec2 range = texelFetch(u_tiles, tile.y * u_tilesX + tile.x).xy;
+
+			vec3 light = u_ambient;
+
+			for(int i = 0; i < range.y; i++)
+			{
+				int l = texelFetch(u_indices, range.x + i).x;
+				vec4 data = texelFetch(u_lights, l * 2);
+				vec3 c = texelFetch(u_lights, l * 2 + 1).rgb;
+
+				float att = clamp(1.0 - distance(gl_FragCoord.xy, data.xy) / data.z, 0.0, 1.0);
+				light += c * (data.w * att * att);
+			}
+
+			color = vec4(light * 0.5, 1);
+		})";
+
+	static const char *lightCompositeFragmentShader =
+		GL2D_OPNEGL_SHADER_VERSION "\n"
+		GL2D_OPNEGL_SHADER_PRECISION "\n"
+		R"(out vec4 color;
+		in vec2 v_texture;
+		uniform sampler2D u_sampler;
+		void main()
+		{
+			color = texture(u_sampler, v_texture);
+		})";
+
+	void initgl2dLightSystem()
+	{
+		lightShader = createShaderProgram(fullScreenVertexShader, lightFragmentShader).id;
+		lightShaderTileSize = glGetUniformLocation(lightShader, "u_tileSize");
+		lightShaderTilesX = glGetUniformLocation(lightShader, "u_tilesX");
+		lightShaderAmbient = glGetUniformLocation(lightShader, "u_ambient");
+
+		glUseProgram(lightShader);
+		glUniform1i(glGetUniformLocation(lightShader, "u_lights"), 0);
+		glUniform1i(glGetUniformLocation(lightShader, "u_tiles"), 1);
+		glUniform1i(glGetUniformLocation(lightShader, "u_indices"), 2);
+
+		lightCompositeShader = createShaderProgram(fullScreenVertexShader, lightCompositeFragmentShader).id;
+		glUseProgram(lightCompositeShader);
+		glUniform1i(glGetUniformLocation(lightCompositeShader, "u_sampler"), 0);
+
+		glUseProgram(0);
+	}
+
+	void cleanupgl2dLightSystem()
+	{
+		glDeleteProgram(lightShader);
+		glDeleteProgram(lightCompositeShader);
+		lightShader = 0;
+		lightCompositeShader = 0;
+	}
+
+	static void createBufferTexture(GLuint &buffer, GLuint &texture, GLenum format)
+	{
+		glGenBuffers(1, &buffer);
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+		glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_BUFFER, texture);
+		glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	static void uploadBufferTexture(GLuint buffer, const void *data, size_t size)
+	{
+		glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+		if (size)
+		{
+			//orphan the old storage so the gpu doesn't have to wait for the last frame
+			glBufferData(GL_TEXTURE_BUFFER, size, nullptr, GL_STREAM_DRAW);
+			glBufferData(GL_TEXTURE_BUFFER, size, data, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+	}
+
+	void LightSystem::create(float resolutionScale, int tileSize)
+	{
+		cleanup();
+
+		this->resolutionScale = resolutionScale;
+		this->tileSize = tileSize;
+
+		fb.create(1, 1);
+		fbSize = {1, 1};
+
+		glGenVertexArrays(1, &vao);
+
+		createBufferTexture(lightsBuffer, lightsTexture, GL_RGBA32F);
+		createBufferTexture(tilesBuffer, tilesTexture, GL_RG32I);
+		createBufferTexture(indicesBuffer, indicesTexture, GL_R32I);
+	}
+
+	void LightSystem::cleanup()
+	{
+		fb.cleanup();
+		fbSize = {};
+
+		if (vao)
+		{
+			glDeleteVertexArrays(1, &vao);
+			glDeleteTextures(1, &lightsTexture);
+			glDeleteTextures(1, &tilesTexture);
+			glDeleteTextures(1, &indicesTexture);
+			glDeleteBuffers(1, &lightsBuffer);
+			glDeleteBuffers(1, &tilesBuffer);
+			glDeleteBuffers(1, &indicesBuffer);
+		}
+
+		vao = 0;
+		lightsBuffer = 0;
+		lightsTexture = 0;
+		tilesBuffer = 0;
+		tilesTexture = 0;
+		indicesBuffer = 0;
+		indicesTexture = 0;
+
+		lights.clear();
+	}
+
+	void LightSystem::addLight(glm::vec2 position, float radius, glm::vec3 color, float intensity)
+	{
+		PointLight l;
+		l.position = position;
+		l.radius = radius;
+		l.color = color;
+		l.intensity = intensity;
+		lights.push_back(l);
+	}
+
+	void LightSystem::addLight(const PointLight &light)
+	{
+		lights.push_back(light);
+	}
+
+	void LightSystem::clearLights()
+	{
+		lights.clear();
+	}
+
+	void LightSystem::render(Renderer2D &renderer)
+	{
+		if (!vao)
+		{
+			internal::reportError("LightSystem not initialized. Have you forgotten to call create() ?");
+			return;
+		}
+
+		if (!lightShader)
+		{
+			internal::reportError("Light shader not initialized. Have you forgotten to call initgl2dLightSystem() ?");
+			return;
+		}
+
+		if (renderer.windowW <= 0 || renderer.windowH <= 0)
+		{
+			return;
+		}
+
+		tileSize = std::max(tileSize, 1);
+
+		const glm::ivec2 size = {
+			std::max(1, (int)(renderer.windowW * resolutionScale)),
+			std::max(1, (int)(renderer.windowH * resolutionScale))};
+
+		if (size != fbSize)
+		{
+			fb.resize(size.x, size.y);
+			fbSize = size;
+		}
+
+		const int tilesX = (size.x + tileSize - 1) / tileSize;
+		const int tilesY = (size.y + tileSize - 1) / tileSize;
+
+		if (renderer.currentCamera.rotation != renderer.pipelineCameraRotation
+			|| renderer.currentCamera.zoom != renderer.pipelineCameraZoom || !renderer.pointTransform)
+		{
+			renderer.updateTransformPipeline();
+		}
+
+		//world pixels to light buffer pixels (bottom left origin like gl_FragCoord)
+		const float pixelScale = (float)size.x / renderer.windowW * renderer.currentCamera.zoom;
+
+		lightData.clear();
+		tileRanges.assign(tilesX * tilesY, {0, 0});
+		tileCounters.assign(tilesX * tilesY, 0);
+
+		struct TileBounds { int x0, y0, x1, y1; };
+		std::vector<TileBounds> bounds;
+		bounds.reserve(lights.size());
+
+		//pass 1, transform the lights and count them per tile
+		for (auto &l : lights)
+		{
+			glm::vec2 p = {l.position.x, -l.position.y};
+			renderer.pointTransform(&p, 1, renderer.currentCamera, (float)renderer.windowW, (float)renderer.windowH);
+			p = (p * 0.5f + 0.5f) * glm::vec2(size);
+
+			const float r = l.radius * pixelScale;
+
+			if (r <= 0 || l.intensity <= 0 || p.x + r < 0 || p.y + r < 0 || p.x - r > size.x || p.y - r > size.y)
+			{
+				continue;
+			}
+
+			TileBounds b;
+			b.x0 = std::max(0, (int)std::floor((p.x - r) / tileSize));
+			b.y0 = std::max(0, (int)std::floor((p.y - r) / tileSize));
+			b.x1 = std::min(tilesX - 1, (int)std::floor((p.x + r) / tileSize));
+			b.y1 = std::min(tilesY - 1, (int)std::floor((p.y + r) / tileSize));
+			bounds.push_back(b);
+
+			lightData.push_back({p.x, p.y, r, l.intensity});
+			lightData.push_back({l.color, 0});
+
+			for (int y = b.y0; y <= b.y1; y++)
+				for (int x = b.x0; x <= b.x1; x++)
+				{
+					tileCounters[y * tilesX + x]++;
+				}
+		}
+
+		//pass 2, prefix sum for the offsets and fill the index list
+		int total = 0;
+		for (int i = 0; i < tilesX * tilesY; i++)
+		{
+			tileRanges[i] = {total, 0};
+			total += tileCounters[i];
+		}
+
+		tileIndices.resize(total);
+
+		for (int i = 0; i < (int)bounds.size(); i++)
+		{
+			auto &b = bounds[i];
+			for (int y = b.y0; y <= b.y1; y++)
+				for (int x = b.x0; x <= b.x1; x++)
+				{
+					auto &range = tileRanges[y * tilesX + x];
+					tileIndices[range.x + range.y] = i;
+					range.y++;
+				}
+		}
+
+		uploadBufferTexture(lightsBuffer, lightData.data(), lightData.size() * sizeof(lightData[0]));
+		uploadBufferTexture(tilesBuffer, tileRanges.data(), tileRanges.size() * sizeof(tileRanges[0]));
+		uploadBufferTexture(indicesBuffer, tileIndices.data(), tileIndices.size() * sizeof(tileIndices[0]));
+
+		//accumulate the lights
+		glBindFramebuffer(GL_FRAMEBUFFER, fb.fbo);
+		glViewport(0, 0, size.x, size.y);
+		glDisable(GL_BLEND);
+		glDisable(GL_DEPTH_TEST);
+
+		glUseProgram(lightShader);
+		glUniform1i(lightShaderTileSize, tileSize);
+		glUniform1i(lightShaderTilesX, tilesX);
+		glUniform3f(lightShaderAmbient, ambient.r, ambient.g, ambient.b);
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_BUFFER, lightsTexture);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_BUFFER, tilesTexture);
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_BUFFER, indicesTexture);
+
+		glBindVertexArray(vao);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+		//multiply over the scene, dst * src * 2
+		glBindFramebuffer(GL_FRAMEBUFFER, renderer.defaultFBO);
+		glViewport(0, 0, renderer.windowW, renderer.windowH);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_DST_COLOR, GL_SRC_COLOR);
+
+		glUseProgram(lightCompositeShader);
+		glBindTexture(GL_TEXTURE_2D, fb.texture.id);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+
+		glBindVertexArray(0);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		enableNecessaryGLFeatures();
+	}
+
+}
@@ -1,56 +1,44 @@
 #include <gl2d/gl2dParticleSystem.h>
+#include <cstring>
+
+//the simd backends, the instruction set is checked at runtime
+#if GL2D_SIMD != 0 && (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86))
+#define GL2D_PARTICLE_X86 1
+#else
+#define GL2D_PARTICLE_X86 0
+#endif
+
+#if GL2D_PARTICLE_X86
+
+#include <immintrin.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define GL2D_TARGET(x)
+#else
+#define GL2D_TARGET(x) __attribute__((target(x)))
+#endif
+
+#endif
 
 namespace gl2d
 {
 
-	static ShaderProgram defaultParticleShader = {};
-
-	static const char *defaultParticleVertexShader =
-		GL2D_OPNEGL_SHADER_VERSION "\n"
-		GL2D_OPNEGL_SHADER_PRECISION "\n"
-		"in vec2 quad_positions;\n"
-		"in vec4 quad_colors;\n"
-		"in vec2 texturePositions;\n"
-		"out vec4 v_color;\n"
-		"out vec2 v_texture;\n"
-		"void main()\n"
-		"{\n"
-		"	gl_Position = vec4(quad_positions, 0, 1);\n"
-		"	v_color = quad_colors;\n"
-		"	v_texture = texturePositions;\n"
-		"}\n";
+	//the pixelated particles are composited over the scene by this chain
+	static PostProcessChain particlePostProcess;
 
 	static const char *defaultParcileFragmentShader =
 		GL2D_OPNEGL_SHADER_VERSION "\n"
 		GL2D_OPNEGL_SHADER_PRECISION "\n"
 		R"(out vec4 color;
-			in vec4 v_color;
 			in vec2 v_texture;
 			uniform sampler2D u_sampler;
 			
-			vec3 rgbTohsv(vec3 c)
-			{
-				vec4 K = vec4(0.0, -1.0 / 3.0, 2.0 / 3.0, -1.0);
-				vec4 p = mix(vec4(c.bg, K.wz), vec4(c.gb, K.xy), step(c.b, c.g));
-				vec4 q = mix(vec4(p.xyw, c.r), vec4(c.r, p.yzx), step(p.x, c.r));
-			
-				float d = q.x - min(q.w, q.y);
-				float e = 1.0e-10;
-				return vec3(abs(q.z + (q.w - q.y) / (6.0 * d + e)), d / (q.x + e), q.x);
-			}
-			
-			vec3 hsvTorgb(vec3 c)
-			{
-				vec4 K = vec4(1.0, 2.0 / 3.0, 1.0 / 3.0, 3.0);
-				vec3 p = abs(fract(c.xxx + K.xyz) * 6.0 - K.www);
-				return c.z * mix(K.xxx, clamp(p - K.xxx, 0.0, 1.0), c.y);
-			}
-			
 			const float cFilter = 5.f;
 			
 			void main()
 			{
-				color = v_color * texture2D(u_sampler, v_texture);
+				color = texture(u_sampler, v_texture);
 				
 				if(color.a <0.01)discard;
 				//color.a = 1.f;
@@ -61,10 +49,6 @@ namespace gl2d
 				color.rgb = floor(color.rgb);		//remove color quality to get a retro effect
 				color.rgb /= cFilter;				//
 			
-				//color.rgb = rgbTohsv(color.rgb);
-			
-				//color.rgb = hsvTorgb(color.rgb);
-			
 			})";
 
 
@@ -81,7 +65,8 @@ void ParticleSystem::initParticleSystem(int size)
 #pragma region allocations
 
 
-	int size32Aligned = size + (4 - (size % 4));
+	//padded so the widest simd backend (16 floats) never reads past the arrays
+	int size32Aligned = (size + 15) / 16 * 16;
 
 	posX = new float[size32Aligned];
 	posY = new float[size32Aligned];
@@ -102,9 +87,25 @@ void ParticleSystem::initParticleSystem(int size)
 	tranzitionType = new char[size32Aligned];
 	textures = new gl2d::Texture * [size32Aligned];
 	emitTime = new float[size32Aligned];
+	deadIndices = new int[size32Aligned];
 
 #pragma endregion
 
+	//the simd loops run over the dead slots at the end of the alive range, they must hold valid numbers
+	for (int i = 0; i < size32Aligned; i++)
+	{
+		posX[i] = 0;
+		posY[i] = 0;
+		directionX[i] = 0;
+		directionY[i] = 0;
+		rotation[i] = 0;
+		dragX[i] = 0;
+		dragY[i] = 0;
+		rotationSpeed[i] = 0;
+		rotationDrag[i] = 0;
+		duration[i] = 0;
+	}
+
 	for (int i = 0; i < size; i++)
 	{
 		duration[i] = 0;
@@ -115,36 +116,258 @@ void ParticleSystem::initParticleSystem(int size)
 		emitParticle[i] = nullptr;
 	}
 
-	fb.create(100, 100);
+	aliveCount = 0;
 
 }
 
-#if GL2D_SIMD != 0
+#pragma region simd
+
+//The kernels use a multiply and an add (not fma) so every backend rounds exactly like the scalar one.
+//The compiler must not fuse them either (gnu++ modes and the avx512f target would), until the end of the region.
+//They process count rounded up to their width, the particle arrays are padded for the widest one.
+#if defined(_MSC_VER) && !defined(__clang__)
+#pragma fp_contract(off)
+#elif defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
 
-#if defined(_MSC_VER)
-/* Microsoft C/C++-compatible compiler */
-#include <intrin.h>
-#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
-/* GCC-compatible compiler, targeting x86/x86-64 */
-#include <x86intrin.h>
-#elif defined(__GNUC__) && defined(__ARM_NEON__)
-/* GCC-compatible compiler, targeting ARM with NEON */
-#include <arm_neon.h>
-#elif defined(__GNUC__) && defined(__IWMMXT__)
-/* GCC-compatible compiler, targeting ARM with WMMX */
-#include <mmintrin.h>
-#elif (defined(__GNUC__) || defined(__xlC__)) && (defined(__VEC__) || defined(__ALTIVEC__))
-/* XLC or GCC-compatible compiler, targeting PowerPC with VMX/VSX */
-#include <altivec.h>
-#elif defined(__GNUC__) && defined(__SPE__)
-/* GCC-compatible compiler, targeting PowerPC with SPE */
-#include <spe.h>
-#elif
-#undef GL2D_SIMD
-#define GL2D_SIMD 0
+static void integrateScalar(float *value, const float *rate, float deltaTime, int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		value[i] += deltaTime * rate[i];
+	}
+}
+
+static int updateLifetimesScalar(float *duration, float deltaTime, int count, int *dead)
+{
+	int deadCount = 0;
+
+	for (int i = 0; i < count; i++)
+	{
+		if (duration[i] > 0)
+			duration[i] -= deltaTime;
+
+		if (duration[i] <= 0)
+			dead[deadCount++] = i;
+	}
+
+	return deadCount;
+}
+
+#if GL2D_PARTICLE_X86
+
+//adds the set bits of mask (lane 0 first) as particle indices, lanes past count are padding
+static inline int pushDeadLanes(unsigned int mask, int first, int count, int *dead, int deadCount)
+{
+	while (mask)
+	{
+		int lane = 0;
+		while (!(mask & (1u << lane))) { lane++; }
+		mask &= mask - 1;
+
+		if (first + lane < count)
+			dead[deadCount++] = first + lane;
+	}
+
+	return deadCount;
+}
+
+GL2D_TARGET("sse2")
+static void integrateSSE2(float *value, const float *rate, float deltaTime, int count)
+{
+	const __m128 dt = _mm_set1_ps(deltaTime);
+
+	for (int i = 0; i < count; i += 4)
+	{
+		const __m128 v = _mm_loadu_ps(value + i);
+		const __m128 r = _mm_loadu_ps(rate + i);
+		_mm_storeu_ps(value + i, _mm_add_ps(v, _mm_mul_ps(dt, r)));
+	}
+}
+
+GL2D_TARGET("sse2")
+static int updateLifetimesSSE2(float *duration, float deltaTime, int count, int *dead)
+{
+	const __m128 dt = _mm_set1_ps(deltaTime);
+	const __m128 zero = _mm_setzero_ps();
+	int deadCount = 0;
+
+	for (int i = 0; i < count; i += 4)
+	{
+		__m128 d = _mm_loadu_ps(duration + i);
+		const __m128 alive = _mm_cmpgt_ps(d, zero);
+		d = _mm_or_ps(_mm_and_ps(alive, _mm_sub_ps(d, dt)), _mm_andnot_ps(alive, d));
+		_mm_storeu_ps(duration + i, d);
+
+		const unsigned int mask = _mm_movemask_ps(_mm_cmple_ps(d, zero));
+		deadCount = pushDeadLanes(mask, i, count, dead, deadCount);
+	}
+
+	return deadCount;
+}
+
+GL2D_TARGET("avx2")
+static void integrateAVX2(float *value, const float *rate, float deltaTime, int count)
+{
+	const __m256 dt = _mm256_set1_ps(deltaTime);
+
+	for (int i = 0; i < count; i += 8)
+	{
+		const __m256 v = _mm256_loadu_ps(value + i);
+		const __m256 r = _mm256_loadu_ps(rate + i);
+		_mm256_storeu_ps(value + i, _mm256_add_ps(v, _mm256_mul_ps(dt, r)));
+	}
+}
+
+GL2D_TARGET("avx2")
+static int updateLifetimesAVX2(float *duration, float deltaTime, int count, int *dead)
+{
+	const __m256 dt = _mm256_set1_ps(deltaTime);
+	const __m256 zero = _mm256_setzero_ps();
+	int deadCount = 0;
+
+	for (int i = 0; i < count; i += 8)
+	{
+		__m256 d = _mm256_loadu_ps(duration + i);
+		const __m256 alive = _mm256_cmp_ps(d, zero, _CMP_GT_OQ);
+		d = _mm256_blendv_ps(d, _mm256_sub_ps(d, dt), alive);
+		_mm256_storeu_ps(duration + i, d);
+
+		const unsigned int mask = _mm256_movemask_ps(_mm256_cmp_ps(d, zero, _CMP_LE_OQ));
+		deadCount = pushDeadLanes(mask, i, count, dead, deadCount);
+	}
+
+	return deadCount;
+}
+
+GL2D_TARGET("avx512f")
+static void integrateAVX512(float *value, const float *rate, float deltaTime, int count)
+{
+	const __m512 dt = _mm512_set1_ps(deltaTime);
+
+	for (int i = 0; i < count; i += 16)
+	{
+		const __m512 v = _mm512_loadu_ps(value + i);
+		const __m512 r = _mm512_loadu_ps(rate + i);
+		_mm512_storeu_ps(value + i, _mm512_add_ps(v, _mm512_mul_ps(dt, r)));
+	}
+}
+
+GL2D_TARGET("avx512f")
+static int updateLifetimesAVX512(float *duration, float deltaTime, int count, int *dead)
+{
+	const __m512 dt = _mm512_set1_ps(deltaTime);
+	const __m512 zero = _mm512_setzero_ps();
+	int deadCount = 0;
+
+	for (int i = 0; i < count; i += 16)
+	{
+		__m512 d = _mm512_loadu_ps(duration + i);
+		const __mmask16 alive = _mm512_cmp_ps_mask(d, zero, _CMP_GT_OQ);
+		d = _mm512_mask_sub_ps(d, alive, d, dt);
+		_mm512_storeu_ps(duration + i, d);
+
+		const unsigned int mask = _mm512_cmp_ps_mask(d, zero, _CMP_LE_OQ);
+		deadCount = pushDeadLanes(mask, i, count, dead, deadCount);
+	}
+
+	return deadCount;
+}
+
+static bool cpuSupports(const char *name)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4] = {};
+	__cpuid(info, 0);
+	if (info[0] < 7) { return strcmp(name, "sse2") == 0; }
+
+	__cpuid(info, 1);
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+
+	__cpuidex(info, 7, 0);
+
+	if (strcmp(name, "sse2") == 0) { return true; }
+	if (strcmp(name, "avx2") == 0) { return (info[1] & (1 << 5)) && (xcr0 & 0x6) == 0x6; }
+	if (strcmp(name, "avx512f") == 0) { return (info[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6; }
+	return false;
+#else
+	__builtin_cpu_init();
+	if (strcmp(name, "sse2") == 0) { return __builtin_cpu_supports("sse2"); }
+	if (strcmp(name, "avx2") == 0) { return __builtin_cpu_supports("avx2"); }
+	if (strcmp(name, "avx512f") == 0) { return __builtin_cpu_supports("avx512f"); }
+	return false;
 #endif
+}
+
+#endif
+
+static const ParticleSimdBackend particleBackends[] =
+{
+	{"scalar", 1, integrateScalar, updateLifetimesScalar},
+#if GL2D_PARTICLE_X86
+	{"sse2", 4, integrateSSE2, updateLifetimesSSE2},
+	{"avx2", 8, integrateAVX2, updateLifetimesAVX2},
+	{"avx512", 16, integrateAVX512, updateLifetimesAVX512},
+#endif
+};
 
+static bool particleBackendSupported(const ParticleSimdBackend &b)
+{
+#if GL2D_PARTICLE_X86
+	if (b.integrate == integrateSSE2) { return cpuSupports("sse2"); }
+	if (b.integrate == integrateAVX2) { return cpuSupports("avx2"); }
+	if (b.integrate == integrateAVX512) { return cpuSupports("avx512f"); }
 #endif
+	return true;
+}
+
+static const ParticleSimdBackend *particleBackend = nullptr;
+
+const ParticleSimdBackend &getParticleSimdBackend()
+{
+	if (!particleBackend)
+	{
+		//the widest one the cpu supports
+		for (auto &b : particleBackends)
+		{
+			if (particleBackendSupported(b))
+			{
+				particleBackend = &b;
+			}
+		}
+	}
+
+	return *particleBackend;
+}
+
+bool setParticleSimdBackend(const char *name)
+{
+	for (auto &b : particleBackends)
+	{
+		if (strcmp(b.name, name) == 0 && particleBackendSupported(b))
+		{
+			particleBackend = &b;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#pragma fp_contract(on)
+#elif defined(__clang__)
+#pragma STDC FP_CONTRACT DEFAULT
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
+#pragma endregion
 
 void ParticleSystem::applyMovement(float deltaTime)
 {
@@ -191,163 +414,60 @@ void ParticleSystem::applyMovement(float deltaTime)
 #pragma endregion
 
 
-	for (int i = 0; i < size; i++)
-	{
-
-		if (duration[i] > 0)
-			duration[i] -= deltaTime;
+	auto &simd = getParticleSimdBackend();
 
-		if (emitTime[i] > 0 && emitParticle[i])
-			emitTime[i] -= deltaTime;
+	//the dead particles are removed after the sub emitters had their turn
+	const int deadCount = simd.updateLifetimes(duration, deltaTime, aliveCount, deadIndices);
 
-		if (duration[i] <= 0)
-		{
-			if (deathRattle[i] != nullptr && deathRattle[i]->onCreateCount)
-			{
-
-				this->emitParticleWave(deathRattle[i], {posX[i], posY[i]});
-
-			}
+	//only the particles that were alive before, the new ones are appended after them
+	const int updatedCount = aliveCount;
+	for (int i = 0; i < updatedCount; i++)
+	{
+		if (!emitParticle[i])
+			continue;
 
-			deathRattle[i] = nullptr;
-			duration[i] = 0;
-			sizeXY[i] = 0;
-			emitParticle[i] = nullptr;
+		if (emitTime[i] > 0)
+			emitTime[i] -= deltaTime;
 
-		}
-		else if (emitTime[i] <= 0 && emitParticle[i])
+		if (duration[i] > 0 && emitTime[i] <= 0)
 		{
 			emitTime[i] = rand(thisParticleSettings[i]->subemitParticleTime);
 
 			//emit particle
 			this->emitParticleWave(emitParticle[i], {posX[i], posY[i]});
-
 		}
-
 	}
 
-	__m128 _deltaTime = _mm_set1_ps(deltaTime);
-
-#pragma region applyDrag
-
-#if GL2D_SIMD == 0
-	for (int i = 0; i < size; i++)
+	//from the last one, so the particle that removeParticle moves into the slot is always alive
+	for (int k = deadCount - 1; k >= 0; k--)
 	{
-		//if (duration[i] > 0)
-		directionX[i] += deltaTime * dragX[i];
-	}
-
-	for (int i = 0; i < size; i++)
-	{
-		//if (duration[i] > 0)
-		directionY[i] += deltaTime * dragY[i];
-
-	}
-
-	for (int i = 0; i < size; i++)
-	{
-
-		//if (duration[i] > 0)
-		rotationSpeed[i] += deltaTime * rotationDrag[i];
-	}
-#else
-
-	for (int i = 0; i < size; i += 4)
-	{
-		//directionX[i] += deltaTime * dragX[i];
-
-		__m128 *dir = (__m128 *) & (directionX[i]);
-		__m128 *drag = (__m128 *) & (dragX[i]);
+		const int i = deadIndices[k];
 
-		*dir = _mm_fmadd_ps(_deltaTime, *drag, *dir);
-	}
-
-	for (int i = 0; i < size; i += 4)
-	{
-		//directionY[i] += deltaTime * dragY[i];
-
-		__m128 *dir = (__m128 *) & (directionY[i]);
-		__m128 *drag = (__m128 *) & (dragY[i]);
-
-		*dir = _mm_fmadd_ps(_deltaTime, *drag, *dir);
-	}
-
-	for (int i = 0; i < size; i += 4)
-	{
-		//rotationSpeed[i] += deltaTime * rotationDrag[i];
-
-		__m128 *dir = (__m128 *) & (rotationSpeed[i]);
-		__m128 *drag = (__m128 *) & (rotationDrag[i]);
+		if (deathRattle[i] != nullptr && deathRattle[i]->onCreateCount)
+		{
+			this->emitParticleWave(deathRattle[i], {posX[i], posY[i]});
+		}
 
-		*dir = _mm_fmadd_ps(_deltaTime, *drag, *dir);
+		removeParticle(i);
 	}
-#endif
 
+#pragma region applyDrag
 
+	simd.integrate(directionX, dragX, deltaTime, aliveCount);
+	simd.integrate(directionY, dragY, deltaTime, aliveCount);
+	simd.integrate(rotationSpeed, rotationDrag, deltaTime, aliveCount);
 
 #pragma endregion
 
 
 #pragma region apply movement
 
-
-#if GL2D_SIMD == 0
-	for (int i = 0; i < size; i++)
-	{
-		//if (duration[i] > 0)
-		posX[i] += deltaTime * directionX[i];
-
-	}
-
-
-	for (int i = 0; i < size; i++)
-	{
-		//if (duration[i] > 0)
-		posY[i] += deltaTime * directionY[i];
-
-	}
-
-	for (int i = 0; i < size; i++)
-	{
-		//if (duration[i] > 0)
-		rotation[i] += deltaTime * rotationSpeed[i];
-
-	}
-#else 
-	for (int i = 0; i < size; i += 4)
-	{
-		//posX[i] += deltaTime * directionX[i];
-		__m128 *dir = (__m128 *) & (posX[i]);
-		__m128 *drag = (__m128 *) & (directionX[i]);
-
-		*dir = _mm_fmadd_ps(_deltaTime, *drag, *dir);
-	}
-
-
-	for (int i = 0; i < size; i++)
-	{
-		//posY[i] += deltaTime * directionY[i];
-		__m128 *dir = (__m128 *) & (posY[i]);
-		__m128 *drag = (__m128 *) & (directionY[i]);
-
-		*dir = _mm_fmadd_ps(_deltaTime, *drag, *dir);
-	}
-
-	for (int i = 0; i < size; i++)
-	{
-		//rotation[i] += deltaTime * rotationSpeed[i];
-		__m128 *dir = (__m128 *) & (rotation[i]);
-		__m128 *drag = (__m128 *) & (rotationSpeed[i]);
-
-		*dir = _mm_fmadd_ps(_deltaTime, *drag, *dir);
-	}
-
-#endif
+	simd.integrate(posX, directionX, deltaTime, aliveCount);
+	simd.integrate(posY, directionY, deltaTime, aliveCount);
+	simd.integrate(rotation, rotationSpeed, deltaTime, aliveCount);
 
 #pragma endregion
 
-
-
 }
 
 void ParticleSystem::cleanup()
@@ -369,6 +489,7 @@ void ParticleSystem::cleanup()
 	delete[] rotationSpeed;
 	delete[] rotationDrag;
 	delete[] emitTime;
+	delete[] deadIndices;
 	delete[] tranzitionType;
 	delete[] deathRattle;
 	delete[] thisParticleSettings;
@@ -391,6 +512,8 @@ void ParticleSystem::cleanup()
 	rotationDrag = 0;
 	emitTime = 0;
 	tranzitionType = 0;
+	deadIndices = 0;
+	aliveCount = 0;
 	deathRattle = 0;
 	thisParticleSettings = 0;
 	emitParticle = 0;
@@ -398,54 +521,83 @@ void ParticleSystem::cleanup()
 
 	size = 0;
 
-
-	fb.cleanup();
 }
 
 void ParticleSystem::emitParticleWave(ParticleSettings *ps, glm::vec2 pos)
 {
-	int recreatedParticlesThisFrame = 0;
-
-	for (int i = 0; i < size; i++)
+	for (int created = 0; created < ps->onCreateCount && aliveCount < size; created++)
 	{
+		const int i = aliveCount++;
+
+		duration[i] = rand(ps->particleLifeTime);
+		durationTotal[i] = duration[i];
+
+		//reset particle
+		posX[i] = pos.x + rand(ps->positionX);
+		posY[i] = pos.y + rand(ps->positionY);
+		directionX[i] = rand(ps->directionX);
+		directionY[i] = rand(ps->directionY);
+		rotation[i] = rand(ps->rotation);;
+		sizeXY[i] = rand(ps->createApearence.size);
+		dragX[i] = rand(ps->dragX);
+		dragY[i] = rand(ps->dragY);
+		color[i].x = rand({ps->createApearence.color1.x, ps->createApearence.color2.x});
+		color[i].y = rand({ps->createApearence.color1.y, ps->createApearence.color2.y});
+		color[i].z = rand({ps->createApearence.color1.z, ps->createApearence.color2.z});
+		color[i].w = rand({ps->createApearence.color1.w, ps->createApearence.color2.w});
+		rotationSpeed[i] = rand(ps->rotationSpeed);
+		rotationDrag[i] = rand(ps->rotationDrag);
+		textures[i] = ps->texturePtr;
+		deathRattle[i] = ps->deathRattle;
+		tranzitionType[i] = ps->tranzitionType;
+		thisParticleSettings[i] = ps;
+		emitParticle[i] = ps->subemitParticle;
+		emitTime[i] = rand(thisParticleSettings[i]->subemitParticleTime);
+	}
 
-		if (recreatedParticlesThisFrame < ps->onCreateCount &&
-			sizeXY[i] == 0)
-		{
-
-			duration[i] = rand(ps->particleLifeTime);
-			durationTotal[i] = duration[i];
-
-			//reset particle
-			posX[i] = pos.x + rand(ps->positionX);
-			posY[i] = pos.y + rand(ps->positionY);
-			directionX[i] = rand(ps->directionX);
-			directionY[i] = rand(ps->directionY);
-			rotation[i] = rand(ps->rotation);;
-			sizeXY[i] = rand(ps->createApearence.size);
-			dragX[i] = rand(ps->dragX);
-			dragY[i] = rand(ps->dragY);
-			color[i].x = rand({ps->createApearence.color1.x, ps->createApearence.color2.x});
-			color[i].y = rand({ps->createApearence.color1.y, ps->createApearence.color2.y});
-			color[i].z = rand({ps->createApearence.color1.z, ps->createApearence.color2.z});
-			color[i].w = rand({ps->createApearence.color1.w, ps->createApearence.color2.w});
-			rotationSpeed[i] = rand(ps->rotationSpeed);
-			rotationDrag[i] = rand(ps->rotationDrag);
-			textures[i] = ps->texturePtr;
-			deathRattle[i] = ps->deathRattle;
-			tranzitionType[i] = ps->tranzitionType;
-			thisParticleSettings[i] = ps;
-			emitParticle[i] = ps->subemitParticle;
-			emitTime[i] = rand(thisParticleSettings[i]->subemitParticleTime);
-
-			recreatedParticlesThisFrame++;
-		}
 
+}
 
+void ParticleSystem::removeParticle(int i)
+{
+	const int last = --aliveCount;
 
+	if (i != last)
+	{
+		posX[i] = posX[last];
+		posY[i] = posY[last];
+		directionX[i] = directionX[last];
+		directionY[i] = directionY[last];
+		rotation[i] = rotation[last];
+		sizeXY[i] = sizeXY[last];
+		dragX[i] = dragX[last];
+		dragY[i] = dragY[last];
+		duration[i] = duration[last];
+		durationTotal[i] = durationTotal[last];
+		color[i] = color[last];
+		rotationSpeed[i] = rotationSpeed[last];
+		rotationDrag[i] = rotationDrag[last];
+		emitTime[i] = emitTime[last];
+		tranzitionType[i] = tranzitionType[last];
+		deathRattle[i] = deathRattle[last];
+		thisParticleSettings[i] = thisParticleSettings[last];
+		emitParticle[i] = emitParticle[last];
+		textures[i] = textures[last];
 	}
 
-
+	//the slot is still integrated by the simd loops when it is in the last vector, so it must stay still
+	duration[last] = 0;
+	sizeXY[last] = 0;
+	directionX[last] = 0;
+	directionY[last] = 0;
+	dragX[last] = 0;
+	dragY[last] = 0;
+	rotationSpeed[last] = 0;
+	rotationDrag[last] = 0;
+	deathRattle[last] = nullptr;
+	thisParticleSettings[last] = nullptr;
+	emitParticle[last] = nullptr;
+	textures[last] = nullptr;
 }
 
 float interpolate(float a, float b, float perc)
@@ -462,26 +614,25 @@ void ParticleSystem::draw(Renderer2D &r)
 
 	auto cam = r.currentCamera;
 
+	gl2d::FrameBuffer fb = {};
+
 	if (postProcessing)
 	{
 
 		r.flush();
 
-		if (fb.texture.GetSize() != glm::ivec2{w / pixelateFactor,h / pixelateFactor})
-		{
-			fb.resize(w / pixelateFactor, h / pixelateFactor);
-
-		}
+		//shared with the other effects that use the renderer's pool
+		fb = r.renderTargets.acquire({w / pixelateFactor, h / pixelateFactor});
 
-		r.updateWindowMetrics(w / pixelateFactor, h / pixelateFactor);
+		//not updateWindowMetrics, that would end the frame of the pool while fb is acquired
+		r.windowW = w / pixelateFactor;
+		r.windowH = h / pixelateFactor;
 
 	}
 
 
-	for (int i = 0; i < size; i++)
+	for (int i = 0; i < aliveCount; i++)
 	{
-		if (sizeXY[i] == 0) { continue; }
-
 		float lifePerc = duration[i] / durationTotal[i]; //close to 0 when gone, 1 when full
 
 		switch (this->tranzitionType[i])
@@ -596,20 +747,12 @@ void ParticleSystem::draw(Renderer2D &r)
 		fb.clear();
 		r.flushFBO(fb);
 
+		r.windowW = w;
+		r.windowH = h;
 
+		particlePostProcess.render(r, fb.texture);
 
-		r.updateWindowMetrics(w, h);
-		r.currentCamera.setDefault();
-
-
-		auto s = r.currentShader;
-
-		r.renderRectangle({0,0,w,h}, fb.texture);
-
-		r.setShaderProgram(defaultParticleShader);
-		r.flush();
-
-		r.setShaderProgram(s);
+		r.renderTargets.release(fb);
 
 	}
 
@@ -631,12 +774,17 @@ float ParticleSystem::rand(glm::vec2 v)
 
 void initgl2dParticleSystem()
 {
-	defaultParticleShader = createShaderProgram(defaultParticleVertexShader, defaultParcileFragmentShader);
+	particlePostProcess = {};
+	particlePostProcess.addPass(createPostProcessShader(defaultParcileFragmentShader));
 }
 
 void cleanupgl2dParticleSystem()
 {
-	glDeleteShader(defaultParticleShader.id);
+	for (auto &p : particlePostProcess.passes)
+	{
+		glDeleteProgram(p.shader.id);
+	}
+	particlePostProcess = {};
 }
 
 
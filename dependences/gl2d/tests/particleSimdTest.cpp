@@ -0,0 +1,186 @@
+//Checks that every simd backend of the particle system gives the same results as the scalar one, bit for bit.
+//Doesn't need an opengl context.
+
+#include <gl2d/gl2dParticleSystem.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static const char *backendNames[] = {"scalar", "sse2", "avx2", "avx512"};
+
+static int failures = 0;
+
+static void check(bool condition, const char *backend, const char *what, int count)
+{
+	if (!condition)
+	{
+		std::printf("FAILED %s: %s (count %d)\n", backend, what, count);
+		failures++;
+	}
+}
+
+struct KernelResult
+{
+	std::vector<float> value;
+	std::vector<float> duration;
+	std::vector<int> dead;
+};
+
+//the arrays are padded like the particle system pads them, the kernels may run over the padding
+static KernelResult runKernels(int count, unsigned int seed)
+{
+	const int padded = (count + 15) / 16 * 16;
+
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> dist(-100, 100);
+
+	std::vector<float> value(padded), rate(padded), duration(padded);
+	for (int i = 0; i < padded; i++)
+	{
+		value[i] = dist(random);
+		rate[i] = dist(random) * 0.37f;
+
+		//some are already dead, some die exactly at 0 and some die this step
+		switch (i % 5)
+		{
+		case 0: duration[i] = 0; break;
+		case 1: duration[i] = -dist(random) * dist(random); break;
+		case 2: duration[i] = 0.25f; break;
+		default: duration[i] = dist(random) * 0.01f; break;
+		}
+	}
+
+	auto &backend = gl2d::getParticleSimdBackend();
+
+	KernelResult r;
+	r.dead.resize(padded);
+
+	for (int step = 0; step < 8; step++)
+	{
+		backend.integrate(value.data(), rate.data(), 0.016f * (step + 1), count);
+	}
+
+	const int deadCount = backend.updateLifetimes(duration.data(), 0.25f, count, r.dead.data());
+
+	//the padding is not part of the result
+	r.value.assign(value.begin(), value.begin() + count);
+	r.duration.assign(duration.begin(), duration.begin() + count);
+	r.dead.resize(deadCount);
+
+	return r;
+}
+
+static void testKernels(const char *name)
+{
+	const int counts[] = {0, 1, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 100, 1001};
+
+	for (int count : counts)
+	{
+		gl2d::setParticleSimdBackend("scalar");
+		const KernelResult expected = runKernels(count, 1234 + count);
+
+		gl2d::setParticleSimdBackend(name);
+		const KernelResult result = runKernels(count, 1234 + count);
+
+		check(std::memcmp(result.value.data(), expected.value.data(), count * sizeof(float)) == 0,
+			name, "integrate", count);
+		check(std::memcmp(result.duration.data(), expected.duration.data(), count * sizeof(float)) == 0,
+			name, "updateLifetimes durations", count);
+		check(result.dead.size() == expected.dead.size()
+			&& std::memcmp(result.dead.data(), expected.dead.data(), result.dead.size() * sizeof(int)) == 0,
+			name, "updateLifetimes dead indices", count);
+	}
+}
+
+//a whole simulation with sub emitters and death rattles
+static std::vector<glm::vec4> runParticleSystem(std::vector<int> &aliveCounts)
+{
+	gl2d::ParticleSettings spark;
+	spark.onCreateCount = 3;
+	spark.particleLifeTime = {0.05f, 0.4f};
+	spark.directionX = {-50, 50};
+	spark.directionY = {-50, 50};
+	spark.rotationSpeed = {-3, 3};
+
+	gl2d::ParticleSettings trail;
+	trail.onCreateCount = 1;
+	trail.particleLifeTime = {0.1f, 0.3f};
+	trail.directionY = {10, 20};
+	trail.dragY = {-5, -1};
+
+	gl2d::ParticleSettings rocket;
+	rocket.onCreateCount = 7;
+	rocket.deathRattle = &spark;
+	rocket.subemitParticle = &trail;
+	rocket.subemitParticleTime = {0.02f, 0.08f};
+	rocket.positionX = {-10, 10};
+	rocket.particleLifeTime = {0.2f, 1.2f};
+	rocket.directionX = {-30, 30};
+	rocket.directionY = {-200, -100};
+	rocket.dragX = {-2, 2};
+	rocket.dragY = {40, 60};
+	rocket.rotation = {0, 6};
+	rocket.rotationSpeed = {-1, 1};
+	rocket.rotationDrag = {-0.5f, 0.5f};
+
+	gl2d::ParticleSystem ps;
+	ps.initParticleSystem(497);
+	ps.seedRandom(42);
+
+	std::vector<glm::vec4> states;
+
+	for (int frame = 0; frame < 240; frame++)
+	{
+		if (frame % 20 == 0)
+		{
+			ps.emitParticleWave(&rocket, {frame * 3.f, 100});
+		}
+
+		ps.applyMovement(1.f / 60.f);
+
+		aliveCounts.push_back(ps.getAliveCount());
+		for (int i = 0; i < ps.getAliveCount(); i++)
+		{
+			states.push_back(ps.getParticleState(i));
+		}
+	}
+
+	ps.cleanup();
+
+	return states;
+}
+
+static void testApplyMovement(const char *name)
+{
+	std::vector<int> expectedCounts, counts;
+
+	gl2d::setParticleSimdBackend("scalar");
+	const std::vector<glm::vec4> expected = runParticleSystem(expectedCounts);
+
+	gl2d::setParticleSimdBackend(name);
+	const std::vector<glm::vec4> result = runParticleSystem(counts);
+
+	check(counts == expectedCounts, name, "applyMovement alive counts", (int)counts.size());
+	check(result.size() == expected.size()
+		&& std::memcmp(result.data(), expected.data(), result.size() * sizeof(glm::vec4)) == 0,
+		name, "applyMovement particles", (int)result.size());
+}
+
+int main()
+{
+	for (const char *name : backendNames)
+	{
+		if (!gl2d::setParticleSimdBackend(name))
+		{
+			std::printf("skipped %s, not available on this cpu\n", name);
+			continue;
+		}
+
+		testKernels(name);
+		testApplyMovement(name);
+
+		std::printf("checked %s\n", name);
+	}
+
+	return failures ? 1 : 0;
+}
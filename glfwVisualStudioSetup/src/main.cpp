@@ -20,22 +20,6 @@
 #include "backends/imgui_impl_opengl3.h"
 #include "imguiThemes.h"
 
-#pragma region File Utils
-static std::string LoadTextFile(const char* path)
-{
-	std::ifstream file(path);
-	if (!file.is_open())
-	{
-		std::cerr << "Failed to open file: " << path << "\n";
-		return {};
-	}
-
-	std::stringstream ss;
-	ss << file.rdbuf();
-	return ss.str();
-}
-#pragma endregion
-
 #pragma region GLFW Error Callback
 static void error_callback(int error, const char* description)
 {
@@ -43,97 +27,6 @@ static void error_callback(int error, const char* description)
 }
 #pragma endregion
 
-#pragma region Shader Compile / Link
-static GLuint compileShader(GLenum type, const char* src)
-{
-	GLuint s = glCreateShader(type);
-	glShaderSource(s, 1, &src, nullptr);
-	glCompileShader(s);
-
-	GLint ok = 0;
-	glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
-	if (!ok)
-	{
-		GLint len = 0;
-		glGetShaderiv(s, GL_INFO_LOG_LENGTH, &len);
-		std::string log(len, '\0');
-		glGetShaderInfoLog(s, len, nullptr, log.data());
-		std::cerr << "[Shader compile error]\n" << log << "\n";
-		glDeleteShader(s);
-		return 0;
-	}
-	return s;
-}
-
-static GLuint createProgram(const char* vsSrc, const char* fsSrc)
-{
-	GLuint vs = compileShader(GL_VERTEX_SHADER, vsSrc);
-	GLuint fs = compileShader(GL_FRAGMENT_SHADER, fsSrc);
-	if (!vs || !fs) return 0;
-
-	GLuint p = glCreateProgram();
-	glAttachShader(p, vs);
-	glAttachShader(p, fs);
-	glLinkProgram(p);
-
-	glDeleteShader(vs);
-	glDeleteShader(fs);
-
-	GLint ok = 0;
-	glGetProgramiv(p, GL_LINK_STATUS, &ok);
-	if (!ok)
-	{
-		GLint len = 0;
-		glGetProgramiv(p, GL_INFO_LOG_LENGTH, &len);
-		std::string log(len, '\0');
-		glGetProgramInfoLog(p, len, nullptr, log.data());
-		std::cerr << "[Program link error]\n" << log << "\n";
-		glDeleteProgram(p);
-		return 0;
-	}
-
-	return p;
-}
-#pragma endregion
-
-#pragma region Mesh Helper (2D positions only)
-struct Mesh
-{
-	GLuint vao = 0;
-	GLuint vbo = 0;
-	GLsizei vertexCount = 0; // glDrawArrays count
-};
-
-static Mesh CreateMesh2D(const float* verts, size_t bytes, GLsizei vertexCount)
-{
-	Mesh m;
-	m.vertexCount = vertexCount;
-
-	glGenVertexArrays(1, &m.vao);
-	glGenBuffers(1, &m.vbo);
-
-	glBindVertexArray(m.vao);
-	glBindBuffer(GL_ARRAY_BUFFER, m.vbo);
-	glBufferData(GL_ARRAY_BUFFER, bytes, verts, GL_STATIC_DRAW);
-
-	// layout(location=0) in vec2 aPos
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-
-	glBindVertexArray(0);
-	return m;
-}
-
-static void DestroyMesh(Mesh& m)
-{
-	if (m.vbo) glDeleteBuffers(1, &m.vbo);
-	if (m.vao) glDeleteVertexArrays(1, &m.vao);
-	m.vbo = 0;
-	m.vao = 0;
-	m.vertexCount = 0;
-}
-#pragma endregion
-
 #pragma region Game Types
 struct Obstacle
 {
@@ -175,6 +68,10 @@ int main(void)
 
 	enableReportGlErrors();
 	glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
+
+	gl2d::init();
+	gl2d::Renderer2D renderer;
+	renderer.create();
 #pragma endregion
 
 // -------------------------------------------------
@@ -211,60 +108,20 @@ int main(void)
 	constexpr float SPIKE_HALF_X = 0.07f;
 	constexpr float SPIKE_HALF_Y = 0.08f;
 
-#pragma endregion
+	// Only redraw the regions that changed into a persistent back buffer (dirty rectangles).
+	// Most of the frame is the flat background so this saves most of the fill cost.
+	constexpr bool USE_DAMAGE_TRACKING = true;
 
-#pragma region Create Meshes
-	// Player square (2 triangles = 6 vertices)
-	float playerVerts[] = {
-		// tri 1
-		-PLAYER_HALF, -PLAYER_HALF,
-		 PLAYER_HALF, -PLAYER_HALF,
-		 PLAYER_HALF,  PLAYER_HALF,
-		 // tri 2
-		 -PLAYER_HALF, -PLAYER_HALF,
-		  PLAYER_HALF,  PLAYER_HALF,
-		 -PLAYER_HALF,  PLAYER_HALF
-	};
+#pragma endregion
 
-	// Spike (inverted triangle ) (3 vertices)
+#pragma region Shapes
+	// Spike (inverted triangle) in NDC, relative to the obstacle position
 	// tip points downward
-	float spikeVerts[] = {
-		 0.0f,  -0.08f,
-		 0.07f,  0.08f,
-		-0.07f,  0.08f
+	const glm::vec2 spikeVerts[3] = {
+		{ 0.0f,         -SPIKE_HALF_Y},
+		{ SPIKE_HALF_X,  SPIKE_HALF_Y},
+		{-SPIKE_HALF_X,  SPIKE_HALF_Y}
 	};
-
-	Mesh playerMesh = CreateMesh2D(playerVerts, sizeof(playerVerts), 6);
-	Mesh spikeMesh = CreateMesh2D(spikeVerts, sizeof(spikeVerts), 3);
-#pragma endregion
-
-#pragma region Load Shaders
-	std::string vertSrc = LoadTextFile("resources/basic.vert");
-	std::string fragSrc = LoadTextFile("resources/basic.frag");
-	if (vertSrc.empty() || fragSrc.empty())
-	{
-		std::cerr << "Shader source empty (check working directory/path)\n";
-		DestroyMesh(playerMesh);
-		DestroyMesh(spikeMesh);
-		glfwDestroyWindow(window);
-		glfwTerminate();
-		return EXIT_FAILURE;
-	}
-
-	GLuint program = createProgram(vertSrc.c_str(), fragSrc.c_str());
-	if (!program)
-	{
-		std::cerr << "Failed to create shader program\n";
-		DestroyMesh(playerMesh);
-		DestroyMesh(spikeMesh);
-		glfwDestroyWindow(window);
-		glfwTerminate();
-		return EXIT_FAILURE;
-	}
-
-	// uniforms
-	GLint locOffset = glGetUniformLocation(program, "uOffset");
-	GLint locColor = glGetUniformLocation(program, "uColor");
 #pragma endregion
 
 #pragma region Game State
@@ -283,6 +140,11 @@ int main(void)
 	float spikeSpeed = SPIKE_SPEED;
 	float difficultyT = 0.0f;
 
+	// persistent back buffer for the damage tracking mode
+	gl2d::FrameBuffer sceneBuffer;
+	gl2d::DamageTracker damageTracker;
+	int sceneW = 0, sceneH = 0;
+
 #pragma endregion
 
 #pragma region Main Loop
@@ -294,6 +156,7 @@ int main(void)
 		int width = 0, height = 0;
 		glfwGetFramebufferSize(window, &width, &height);
 		glViewport(0, 0, width, height);
+		renderer.updateWindowMetrics(width, height);
 
 		// -------------------------------------------------
 		// delta time
@@ -398,23 +261,111 @@ int main(void)
 		// -------------------------------------------------
 		// render
 		// -------------------------------------------------
-		glClear(GL_COLOR_BUFFER_BIT);
-		glUseProgram(program);
-
-		// player (green / yellow if game over)
-		glBindVertexArray(playerMesh.vao);
-		if (!gameOver) glUniform3f(locColor, 0.0f, 1.0f, 0.0f);
-		else           glUniform3f(locColor, 1.0f, 1.0f, 0.0f);
-		glUniform2f(locOffset, playerX, PLAYER_Y);
-		glDrawArrays(GL_TRIANGLES, 0, playerMesh.vertexCount);
-
-		// spikes (red)
-		glBindVertexArray(spikeMesh.vao);
-		glUniform3f(locColor, 1.0f, 0.0f, 0.0f);
-		for (const auto& o : obstacles)
+		// game logic is in NDC, the renderer works in pixels (top left origin)
+		auto toPixels = [&](float x, float y)
+		{
+			return glm::vec2{(x + 1.0f) * 0.5f * width, (1.0f - y) * 0.5f * height};
+		};
+
+		const gl2d::Rect playerRect = {toPixels(playerX - PLAYER_HALF, PLAYER_Y + PLAYER_HALF),
+			PLAYER_HALF * width, PLAYER_HALF * height};
+
+		auto spikeBounds = [&](const Obstacle& o)
 		{
-			glUniform2f(locOffset, o.x, o.y);
-			glDrawArrays(GL_TRIANGLES, 0, spikeMesh.vertexCount);
+			return gl2d::Rect{toPixels(o.x - SPIKE_HALF_X, o.y + SPIKE_HALF_Y),
+				SPIKE_HALF_X * width, SPIKE_HALF_Y * height};
+		};
+
+		auto overlaps = [](const gl2d::Rect& a, const gl2d::Rect& b)
+		{
+			return a.x < b.x + b.z && b.x < a.x + a.z && a.y < b.y + b.w && b.y < a.y + a.w;
+		};
+
+		// draws everything that touches the region (or everything if region is null)
+		auto drawScene = [&](const gl2d::Rect* region)
+		{
+			// player (green / yellow if game over)
+			if (!region || overlaps(*region, playerRect))
+			{
+				renderer.renderRectangle(playerRect,
+					gameOver ? gl2d::Color4f{1, 1, 0, 1} : gl2d::Color4f{0, 1, 0, 1});
+			}
+
+			// spikes (red), batched with the player in the same draw call
+			for (const auto& o : obstacles)
+			{
+				if (region && !overlaps(*region, spikeBounds(o))) { continue; }
+
+				renderer.renderTriangle(
+					toPixels(o.x + spikeVerts[0].x, o.y + spikeVerts[0].y),
+					toPixels(o.x + spikeVerts[1].x, o.y + spikeVerts[1].y),
+					toPixels(o.x + spikeVerts[2].x, o.y + spikeVerts[2].y),
+					Colors_Red);
+			}
+		};
+
+		if (USE_DAMAGE_TRACKING && width > 0 && height > 0)
+		{
+			if (!sceneBuffer.fbo)
+			{
+				sceneBuffer.create(width, height);
+				damageTracker.invalidate();
+			}
+			else if (sceneW != width || sceneH != height)
+			{
+				sceneBuffer.resize(width, height);
+				damageTracker.invalidate();
+			}
+			sceneW = width;
+			sceneH = height;
+
+			damageTracker.addBounds(playerRect);
+			for (const auto& o : obstacles)
+				damageTracker.addBounds(spikeBounds(o));
+
+			const auto& damage = damageTracker.computeDamage(width, height);
+
+			// the damage is in whole pixels, the scissor covers the same pixels as the clip rect
+			auto scissor = [&](const gl2d::Rect& r)
+			{
+				glScissor((int)r.x, height - (int)(r.y + r.w), (int)r.z, (int)r.w); // gl is bottom left
+			};
+
+			glBindFramebuffer(GL_FRAMEBUFFER, sceneBuffer.fbo);
+			glEnable(GL_SCISSOR_TEST);
+
+			// clear only the damaged regions of the back buffer
+			for (const auto& r : damage)
+			{
+				scissor(r);
+				glClear(GL_COLOR_BUFFER_BIT);
+			}
+
+			// redraw what touches them, the clip rects keep it all in one flush
+			for (const auto& r : damage)
+			{
+				renderer.pushClipRect(r);
+				drawScene(&r);
+				renderer.popClipRect();
+			}
+
+			scissor(damageTracker.getDamageBounds());
+			renderer.flushFBO(sceneBuffer);
+			glDisable(GL_SCISSOR_TEST);
+
+			damageTracker.endFrame();
+
+			// copy the back buffer to the window, the HUD is drawn on top by ImGui
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, sceneBuffer.fbo);
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+			glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		}
+		else
+		{
+			glClear(GL_COLOR_BUFFER_BIT);
+			drawScene(nullptr);
+			renderer.flush();
 		}
 
 		// -------------------------------------------------
@@ -474,10 +425,9 @@ int main(void)
 
 
 #pragma region Shutdown
-	glDeleteProgram(program);
-
-	DestroyMesh(playerMesh);
-	DestroyMesh(spikeMesh);
+	sceneBuffer.cleanup();
+	renderer.cleanup();
+	gl2d::clearnup();
 
 	glfwDestroyWindow(window);
 	glfwTerminate();